@@ -0,0 +1,92 @@
+#!/bin/sh
+# usage: ./bench.sh [count] [seed] [threads] [seeds]
+# Builds the corpus generator and the engines into bench/, generates every tier of the corpus there and prints the
+# throughput of each engine per tier. The seventeen tier only runs with seeds, a file of 17 clue puzzles. An engine that
+# gets a puzzle wrong, or leaves one unsolved, is marked failed. MB/s is the input consumed from reading to solved. With
+# zlib and bgzip, or libzstd and zstd, solverAvx2 also runs on the tier compressed as BGZF or as 4MB zstd frames,
+# inflated while it solves. With more than one thread solverAvx2 runs once per --pin placement, pair only on a
+# compressed tier where its inflate workers have something to do.
+set -e
+cd "$(dirname "$0")"
+count=${1:-10000}
+seed=${2:-1}
+threads=${3:-1}
+seeds=${4:-}
+
+mkdir -p bench
+g++ -O3 -march=native corpus.c -o bench/corpus >/dev/null
+g++ -O3 -march=native -mavx2 -pthread solverAvx2.c -o bench/solverAvx2 >/dev/null
+compressed=
+if command -v bgzip >/dev/null && g++ -O3 -march=native -mavx2 -pthread -DUSE_ZLIB solverAvx2.c -o bench/solverAvx2.gz \
+  -lz >/dev/null; then
+  compressed="$compressed solverAvx2.gz"
+fi
+if command -v zstd >/dev/null && g++ -O3 -march=native -mavx2 -pthread -DUSE_ZSTD solverAvx2.c -o bench/solverAvx2.zst \
+  -lzstd >/dev/null; then
+  compressed="$compressed solverAvx2.zst"
+fi
+g++ -std=c++17 -O3 -march=native -mavx2 solverEngine.cpp -o bench/solverEngine >/dev/null
+g++ -O3 -march=native solver1.c -o bench/solver1 >/dev/null
+g++ -O3 -march=native solver2.c -o bench/solver2 >/dev/null
+tiers="easy medium hard adversarial"
+if [ -n "$seeds" ]; then
+  bench/corpus --count "$count" --seed "$seed" --seeds "$seeds" --out bench
+  tiers="easy medium hard seventeen adversarial"
+else
+  bench/corpus --count "$count" --seed "$seed" --out bench
+fi
+
+placements=none
+compressedPlacements=none
+if [ "$threads" -gt 1 ]; then
+  placements="none cores smt"
+  compressedPlacements="none cores smt pair"
+fi
+
+printf '\n%-12s %-14s %-9s %10s %14s %8s  %s\n' tier engine placement ms puzzles/s MB/s status
+for tier in $tiers; do
+  mb=$(wc -c <"bench/$tier.csv" | awk '{ print $1 / 1e6 }')
+  for engine in solverAvx2 $compressed solverEngine solver1 solver2; do
+    input=bench/$tier.csv
+    pins=-
+    case $engine in
+    solverAvx2) pins=$placements ;;
+    solverAvx2.gz)
+      input=bench/$tier.csv.gz
+      pins=$compressedPlacements
+      bgzip -c "bench/$tier.csv" >"$input"
+      ;;
+    solverAvx2.zst)
+      input=bench/$tier.csv.zst
+      pins=$compressedPlacements
+      # zstd only writes the content size of a frame, which the parallel inflate needs, for a file it can stat
+      rm -rf bench/frames && mkdir bench/frames && split -b 4M "bench/$tier.csv" bench/frames/
+      for frame in bench/frames/*; do zstd -q -c "$frame"; done >"$input"
+      ;;
+    esac
+
+    for placement in $pins; do
+      case $placement in
+      -) output=$(bench/$engine "$input" || true) ;;
+      *) output=$(bench/$engine --threads "$threads" --pin "$placement" "$input") ;;
+      esac
+
+      # solverAvx2 and solverEngine time the solve in ms, solver1 and solver2 time the whole run in s, after any FAIL
+      # they printed on the same line
+      # the input MB/s of solverAvx2 counts reading and parsing too, on a compressed input it prints its own
+      echo "$output" | awk -v tier="$tier" -v engine="$engine" -v placement="$placement" -v count="$count" -v mb="$mb" '
+        /Solving [0-9]+ sudokus took:/ { ms = $5 + 0; timed = 1 }
+        /^(Reading|Parsing) input took:/ { inputMs += $4 + 0 }
+        /^Input: .*MB\/s/ { match($0, /[0-9.]+MB\/s/); mbs = substr($0, RSTART, RLENGTH - 4) + 0 }
+        match($0, /took: [0-9.]+s/) { ms = substr($0, RSTART + 6, RLENGTH - 7) * 1000; timed = 1 }
+        /^(Failed|Rejected|Invalid|Wrong|deferred|Failed deferred lanes):/ && $2 + 0 > 0 { failed = 1 }
+        /FAIL|FAAAIIIL/ { failed = 1 }
+        END {
+          if (failed || !timed) status = "failed"; else status = "ok"
+          if (!mbs && ms + inputMs > 0) mbs = mb * 1000 / (ms + inputMs)
+          printf "%-12s %-14s %-9s %10.0f %14.0f %8.0f  %s\n", tier, engine, placement, ms,
+            (ms > 0 ? count * 1000 / ms : 0), mbs, status
+        }'
+    done
+  done
+done
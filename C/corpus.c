@@ -0,0 +1,495 @@
+#include "immintrin.h"
+#include "stdint.h"
+#include "stdio.h"
+#include "stdlib.h"
+#include "string.h"
+#include "time.h"
+
+#define SUDOKU_CELL_COUNT 81
+#define ALL_DIGITS 0x1FF
+// kaggle layout: 81 digits, a comma, 81 digits and a newline
+#define BYTES_FOR_1_SUDOKUS 164
+#define MAX_SEED_PUZZLES 100000
+#define SEED_GIVENS 17
+
+// what it takes to solve a puzzle from its givens
+#define TIER_EASY 0        // naked singles alone
+#define TIER_MEDIUM 1      // hidden singles as well
+#define TIER_HARD 2        // guessing
+#define TIER_SEVENTEEN 3   // 17 clues, drawn from the puzzles of --seeds
+#define TIER_ADVERSARIAL 4 // guessing, few two candidate cells once singles are done, digits against guessing in order
+#define TIER_COUNT 5
+// hard puzzles an adversarial one is picked from
+#define ADVERSARIAL_CANDIDATES 8
+
+typedef struct {
+  uint16_t rows[9], cols[9], boxes[9];
+  uint8_t cells[SUDOKU_CELL_COUNT];
+} board_t;
+
+static const char *tierNames[TIER_COUNT] = {"easy", "medium", "hard", "seventeen", "adversarial"};
+
+static uint8_t peers[SUDOKU_CELL_COUNT][20];
+static uint8_t units[27][9];
+static uint8_t (*seedPuzzles)[SUDOKU_CELL_COUNT];
+static int seedCount;
+
+#pragma region function declerations
+static void setup();
+static uint64_t next_random(uint64_t *state);
+static void shuffle(uint8_t *values, int count, uint64_t *rng);
+
+static int generate(int tier, uint64_t *rng, uint8_t *puzzle, uint8_t *solution);
+static int generate_adversarial(uint64_t *rng, uint8_t *puzzle, uint8_t *solution);
+static int count_bivalue_cells(const uint8_t *puzzle);
+static void relabel_against_guessing(uint8_t *puzzle, uint8_t *solution);
+static void dig(uint8_t *puzzle, int maxTier, uint64_t *rng);
+static void permute_puzzle(const uint8_t *src, uint8_t *dest, uint64_t *rng);
+
+static int load_board(const uint8_t *puzzle, board_t *board);
+static void place(board_t *board, int cell, int digit);
+static int count_solutions(board_t *board, int limit, uint8_t *solution, uint64_t *rng);
+static int rate(const uint8_t *puzzle, uint16_t *candidates);
+static int propagate(uint8_t *cells, uint16_t *candidates, int hiddenSingles);
+
+static int read_seed_puzzles(const char *path);
+static int write_tier(const char *dir, int tier, const uint8_t *puzzles, const uint8_t *solutions, int count);
+static double wall_ms();
+#pragma endregion
+
+// usage: corpus [--count <n>] [--seed <n>] [--tiers easy,medium,hard,seventeen,adversarial] [--seeds <file>] [--out
+// <dir>]. Writes <dir>/<tier>.csv in the kaggle layout with a header and <dir>/<tier>.bin, the 81 cells of every
+// puzzle ('0' blanks) followed by the 81 digits of every solution, as numpy.fromfile(path, uint8).reshape(2, -1, 81)
+// reads it. The same seed always gives the same corpus. 17 clue puzzles are far too rare to dig for, so the seventeen
+// tier needs --seeds: a file of 17 clue puzzles, one per line, each drawn with a random relabeling and reordering. It is
+// one of the default tiers only when --seeds is given.
+int main(int argc, char **argv) {
+  const char *outDir = ".", *tiers = NULL, *seedsPath = NULL;
+  int count = 10000;
+  uint64_t seed = 1;
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "--count") && i + 1 < argc)
+      count = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "--seed") && i + 1 < argc)
+      seed = strtoull(argv[++i], NULL, 10);
+    else if (!strcmp(argv[i], "--tiers") && i + 1 < argc)
+      tiers = argv[++i];
+    else if (!strcmp(argv[i], "--seeds") && i + 1 < argc)
+      seedsPath = argv[++i];
+    else if (!strcmp(argv[i], "--out") && i + 1 < argc)
+      outDir = argv[++i];
+    else {
+      printf("Unknown argument %s\n", argv[i]);
+      return 1;
+    }
+  }
+  count = count < 1 ? 1 : count;
+  if (!tiers)
+    tiers = seedsPath ? "easy,medium,hard,seventeen,adversarial" : "easy,medium,hard,adversarial";
+
+  setup();
+  if (seedsPath && !read_seed_puzzles(seedsPath)) {
+    printf("Could not read 17 clue puzzles from %s\n", seedsPath);
+    return 1;
+  }
+
+  uint8_t *puzzles = (uint8_t *)malloc((size_t)count * SUDOKU_CELL_COUNT);
+  uint8_t *solutions = (uint8_t *)malloc((size_t)count * SUDOKU_CELL_COUNT);
+
+  for (int tier = 0; tier < TIER_COUNT; tier++) {
+    const char *name = strstr(tiers, tierNames[tier]);
+    size_t nameLength = strlen(tierNames[tier]);
+    if (!name || (name[nameLength] && name[nameLength] != ','))
+      continue;
+    if (tier == TIER_SEVENTEEN && !seedCount) {
+      printf("The seventeen tier needs --seeds <file of 17 clue puzzles>\n");
+      return 1;
+    }
+
+    double start = wall_ms();
+    long attempts = 0, givens = 0;
+    for (int i = 0; i < count; i++) {
+      // every puzzle has its own stream, so a puzzle does not depend on the ones before it
+      uint64_t rng = seed * 0x9E3779B97F4A7C15ull ^ ((uint64_t)tier << 56) ^ (uint64_t)i;
+      uint8_t *puzzle = &puzzles[(size_t)i * SUDOKU_CELL_COUNT];
+      attempts += generate(tier, &rng, puzzle, &solutions[(size_t)i * SUDOKU_CELL_COUNT]);
+
+      for (int cell = 0; cell < SUDOKU_CELL_COUNT; cell++)
+        givens += puzzle[cell] != '0';
+    }
+    double end = wall_ms();
+
+    if (write_tier(outDir, tier, puzzles, solutions, count)) {
+      printf("Could not write the %s tier to %s\n", tierNames[tier], outDir);
+      return 1;
+    }
+    printf("%s: %d puzzles, %.1f givens, %.1f attempts each, took: %.0fms\n", tierNames[tier], count,
+           (double)givens / count, (double)attempts / count, end - start);
+  }
+
+  free(puzzles);
+  free(solutions);
+  free(seedPuzzles);
+  return 0;
+}
+
+static void setup() {
+  int counts[27] = {0};
+  for (int cell = 0; cell < SUDOKU_CELL_COUNT; cell++) {
+    int r = cell / 9, c = cell % 9, b = r / 3 * 3 + c / 3, count = 0;
+    units[r][counts[r]++] = (uint8_t)cell;
+    units[9 + c][counts[9 + c]++] = (uint8_t)cell;
+    units[18 + b][counts[18 + b]++] = (uint8_t)cell;
+
+    for (int peer = 0; peer < SUDOKU_CELL_COUNT; peer++) {
+      int pr = peer / 9, pc = peer % 9;
+      if (peer != cell && (pr == r || pc == c || pr / 3 * 3 + pc / 3 == b))
+        peers[cell][count++] = (uint8_t)peer;
+    }
+  }
+}
+
+// splitmix64
+static uint64_t next_random(uint64_t *state) {
+  uint64_t z = (*state += 0x9E3779B97F4A7C15ull);
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+  return z ^ (z >> 31);
+}
+
+static void shuffle(uint8_t *values, int count, uint64_t *rng) {
+  for (int i = count - 1; i > 0; i--) {
+    int j = (int)(next_random(rng) % (uint64_t)(i + 1));
+    uint8_t value = values[i];
+    values[i] = values[j];
+    values[j] = value;
+  }
+}
+
+#pragma region generate
+// Fills a random grid and digs givens out of it until the puzzle is as sparse as the tier allows, then starts over if
+// it came out easier than the tier. Returns the number of grids it took.
+static int generate(int tier, uint64_t *rng, uint8_t *puzzle, uint8_t *solution) {
+  uint16_t candidates[SUDOKU_CELL_COUNT];
+  board_t board;
+  if (tier == TIER_ADVERSARIAL)
+    return generate_adversarial(rng, puzzle, solution);
+
+  for (int attempts = 1;; attempts++) {
+    if (tier == TIER_SEVENTEEN) {
+      permute_puzzle(seedPuzzles[next_random(rng) % (uint64_t)seedCount], puzzle, rng);
+    } else {
+      memset(&board, 0, sizeof(board));
+      count_solutions(&board, 1, solution, rng);
+      memcpy(puzzle, solution, SUDOKU_CELL_COUNT);
+      dig(puzzle, tier, rng);
+    }
+
+    if ((tier == TIER_MEDIUM || tier == TIER_HARD) && rate(puzzle, candidates) != tier)
+      continue;
+
+    // a seed puzzle is only solved once it is permuted
+    if (tier == TIER_SEVENTEEN && (!load_board(puzzle, &board) || count_solutions(&board, 2, solution, NULL) != 1))
+      continue;
+    return attempts;
+  }
+}
+
+// A hard puzzle with no two candidate cell left by singles is too rare to dig for (none in thousands of minimal
+// puzzles), so the puzzle with the fewest of them out of ADVERSARIAL_CANDIDATES is kept. Its digits are then relabeled
+// so a search that tries candidates in ascending order meets the largest digit first.
+static int generate_adversarial(uint64_t *rng, uint8_t *puzzle, uint8_t *solution) {
+  uint8_t candidate[SUDOKU_CELL_COUNT], candidateSolution[SUDOKU_CELL_COUNT];
+  int attempts = 0, fewest = SUDOKU_CELL_COUNT + 1;
+
+  for (int i = 0; i < ADVERSARIAL_CANDIDATES; i++) {
+    attempts += generate(TIER_HARD, rng, candidate, candidateSolution);
+    int bivalue = count_bivalue_cells(candidate);
+    if (bivalue < fewest) {
+      fewest = bivalue;
+      memcpy(puzzle, candidate, SUDOKU_CELL_COUNT);
+      memcpy(solution, candidateSolution, SUDOKU_CELL_COUNT);
+    }
+  }
+
+  relabel_against_guessing(puzzle, solution);
+  return attempts;
+}
+
+static int count_bivalue_cells(const uint8_t *puzzle) {
+  uint16_t candidates[SUDOKU_CELL_COUNT];
+  int count = 0;
+  rate(puzzle, candidates);
+  for (int cell = 0; cell < SUDOKU_CELL_COUNT; cell++)
+    count += _mm_popcnt_u32(candidates[cell]) == 2;
+  return count;
+}
+
+// the solution digits of the open cells, in cell order, become 9, 8, 7 and so on
+static void relabel_against_guessing(uint8_t *puzzle, uint8_t *solution) {
+  uint8_t labels[10] = {0};
+  int next = 9;
+
+  for (int cell = 0; cell < SUDOKU_CELL_COUNT; cell++) {
+    if (puzzle[cell] == '0' && !labels[solution[cell] - '0'])
+      labels[solution[cell] - '0'] = (uint8_t)next--;
+  }
+  for (int digit = 1; digit <= 9; digit++) {
+    if (!labels[digit])
+      labels[digit] = (uint8_t)next--;
+  }
+
+  for (int cell = 0; cell < SUDOKU_CELL_COUNT; cell++) {
+    solution[cell] = (uint8_t)('0' + labels[solution[cell] - '0']);
+    if (puzzle[cell] != '0')
+      puzzle[cell] = solution[cell];
+  }
+}
+
+// removes givens in a random order as long as the solution stays unique and the puzzle needs no more than maxTier
+static void dig(uint8_t *puzzle, int maxTier, uint64_t *rng) {
+  uint16_t candidates[SUDOKU_CELL_COUNT];
+  uint8_t order[SUDOKU_CELL_COUNT];
+  board_t board;
+
+  for (int cell = 0; cell < SUDOKU_CELL_COUNT; cell++)
+    order[cell] = (uint8_t)cell;
+  shuffle(order, SUDOKU_CELL_COUNT, rng);
+
+  for (int i = 0; i < SUDOKU_CELL_COUNT; i++) {
+    uint8_t given = puzzle[order[i]];
+    puzzle[order[i]] = '0';
+
+    // a puzzle singles solve has a unique solution, so only the guessing tiers need the count
+    int rating = rate(puzzle, candidates);
+    if (rating == TIER_HARD && rating <= maxTier) {
+      load_board(puzzle, &board);
+      rating = count_solutions(&board, 2, NULL, NULL) == 1 ? rating : TIER_COUNT;
+    }
+    if (rating > maxTier)
+      puzzle[order[i]] = given;
+  }
+}
+
+// a random puzzle of the same essential form: digits relabeled, bands and the rows in them, stacks and the columns in
+// them reordered, and maybe transposed
+static void permute_puzzle(const uint8_t *src, uint8_t *dest, uint64_t *rng) {
+  uint8_t digits[9] = {1, 2, 3, 4, 5, 6, 7, 8, 9}, bands[3] = {0, 1, 2}, stacks[3] = {0, 1, 2};
+  uint8_t rows[9], cols[9], inBand[3] = {0, 1, 2};
+  int transpose = (int)(next_random(rng) & 1);
+
+  shuffle(digits, 9, rng);
+  shuffle(bands, 3, rng);
+  shuffle(stacks, 3, rng);
+  for (int i = 0; i < 3; i++) {
+    shuffle(inBand, 3, rng);
+    for (int j = 0; j < 3; j++)
+      rows[i * 3 + j] = (uint8_t)(bands[i] * 3 + inBand[j]);
+    shuffle(inBand, 3, rng);
+    for (int j = 0; j < 3; j++)
+      cols[i * 3 + j] = (uint8_t)(stacks[i] * 3 + inBand[j]);
+  }
+
+  for (int r = 0; r < 9; r++) {
+    for (int c = 0; c < 9; c++) {
+      uint8_t ch = transpose ? src[cols[c] * 9 + rows[r]] : src[rows[r] * 9 + cols[c]];
+      dest[r * 9 + c] = ch == '0' ? '0' : (uint8_t)('0' + digits[ch - '1']);
+    }
+  }
+}
+#pragma endregion
+
+#pragma region solve
+// returns 0 if the puzzle holds a character other than '0'..'9' or repeats a given in a unit
+static int load_board(const uint8_t *puzzle, board_t *board) {
+  memset(board, 0, sizeof(*board));
+  for (int cell = 0; cell < SUDOKU_CELL_COUNT; cell++) {
+    if (puzzle[cell] < '0' || puzzle[cell] > '9')
+      return 0;
+    if (puzzle[cell] == '0')
+      continue;
+
+    int digit = puzzle[cell] - '1', r = cell / 9, c = cell % 9, b = r / 3 * 3 + c / 3;
+    if ((board->rows[r] | board->cols[c] | board->boxes[b]) >> digit & 1)
+      return 0;
+    place(board, cell, digit);
+  }
+  return 1;
+}
+
+static inline void place(board_t *board, int cell, int digit) {
+  int r = cell / 9, c = cell % 9;
+  board->cells[cell] = (uint8_t)(digit + 1);
+  board->rows[r] |= (uint16_t)(1 << digit);
+  board->cols[c] |= (uint16_t)(1 << digit);
+  board->boxes[r / 3 * 3 + c / 3] |= (uint16_t)(1 << digit);
+}
+
+// Counts solutions up to limit, guessing on the open cell with the fewest candidates. The first one is written to
+// solution if it is set. With rng the candidates are tried in a random order, which on an empty board fills a random
+// grid.
+static int count_solutions(board_t *board, int limit, uint8_t *solution, uint64_t *rng) {
+  int bestCell = -1, bestCount = 10;
+  uint16_t bestCandidates = 0;
+
+  for (int cell = 0; cell < SUDOKU_CELL_COUNT; cell++) {
+    if (board->cells[cell])
+      continue;
+
+    int r = cell / 9, c = cell % 9;
+    uint16_t candidates = (uint16_t)(ALL_DIGITS & ~(board->rows[r] | board->cols[c] | board->boxes[r / 3 * 3 + c / 3]));
+    int count = _mm_popcnt_u32(candidates);
+    if (count < bestCount) {
+      bestCell = cell;
+      bestCount = count;
+      bestCandidates = candidates;
+      if (count <= 1)
+        break;
+    }
+  }
+
+  if (bestCell < 0) {
+    if (solution) {
+      for (int cell = 0; cell < SUDOKU_CELL_COUNT; cell++)
+        solution[cell] = (uint8_t)('0' + board->cells[cell]);
+    }
+    return 1;
+  }
+
+  uint8_t digits[9];
+  int digitCount = 0, found = 0;
+  for (uint32_t candidates = bestCandidates; candidates; candidates = _blsr_u32(candidates))
+    digits[digitCount++] = (uint8_t)_tzcnt_u32(candidates);
+  if (rng)
+    shuffle(digits, digitCount, rng);
+
+  for (int i = 0; i < digitCount && found < limit; i++) {
+    board_t next = *board;
+    place(&next, bestCell, digits[i]);
+    found += count_solutions(&next, limit - found, found ? NULL : solution, rng);
+  }
+  return found;
+}
+
+// Returns the tier of the singles a puzzle needs: TIER_EASY, TIER_MEDIUM, or TIER_HARD when it needs guessing. The
+// candidates of the open cells are left as singles left them, 0 for the solved cells.
+static int rate(const uint8_t *puzzle, uint16_t *candidates) {
+  uint8_t cells[SUDOKU_CELL_COUNT];
+  memcpy(cells, puzzle, SUDOKU_CELL_COUNT);
+
+  for (int cell = 0; cell < SUDOKU_CELL_COUNT; cell++) {
+    uint16_t taken = 0;
+    for (int i = 0; i < 20; i++)
+      taken |= cells[peers[cell][i]] == '0' ? 0 : (uint16_t)(1 << (cells[peers[cell][i]] - '1'));
+    candidates[cell] = cells[cell] == '0' ? (uint16_t)(ALL_DIGITS & ~taken) : 0;
+  }
+
+  if (!propagate(cells, candidates, 0))
+    return TIER_EASY;
+  return propagate(cells, candidates, 1) ? TIER_HARD : TIER_MEDIUM;
+}
+
+// places singles until there are none left, returns the number of open cells
+static int propagate(uint8_t *cells, uint16_t *candidates, int hiddenSingles) {
+  int open = 0, progress = 1;
+  for (int cell = 0; cell < SUDOKU_CELL_COUNT; cell++)
+    open += cells[cell] == '0';
+
+  while (open && progress) {
+    progress = 0;
+    for (int cell = 0; cell < SUDOKU_CELL_COUNT; cell++) {
+      uint16_t bits = candidates[cell];
+      if (cells[cell] != '0' || !bits || (bits & (bits - 1)))
+        continue;
+
+      cells[cell] = (uint8_t)('1' + _tzcnt_u32(bits));
+      candidates[cell] = 0;
+      for (int i = 0; i < 20; i++)
+        candidates[peers[cell][i]] &= (uint16_t)~bits;
+      --open;
+      progress = 1;
+    }
+
+    if (progress || !hiddenSingles)
+      continue;
+
+    // a digit that fits a single cell of a unit is that cell's only candidate
+    for (int unit = 0; unit < 27; unit++) {
+      uint16_t once = 0, twice = 0;
+      for (int i = 0; i < 9; i++) {
+        twice |= once & candidates[units[unit][i]];
+        once |= candidates[units[unit][i]];
+      }
+      for (int i = 0; i < 9; i++) {
+        uint16_t hidden = candidates[units[unit][i]] & once & (uint16_t)~twice;
+        if (hidden && !(hidden & (hidden - 1)) && candidates[units[unit][i]] != hidden) {
+          candidates[units[unit][i]] = hidden;
+          progress = 1;
+        }
+      }
+    }
+  }
+  return open;
+}
+#pragma endregion
+
+#pragma region io
+static int read_seed_puzzles(const char *path) {
+  FILE *fp = fopen(path, "rb");
+  char line[256];
+  if (!fp)
+    return 0;
+
+  seedPuzzles = (uint8_t(*)[SUDOKU_CELL_COUNT])malloc((size_t)MAX_SEED_PUZZLES * SUDOKU_CELL_COUNT);
+  while (seedCount < MAX_SEED_PUZZLES && fgets(line, sizeof(line), fp)) {
+    if (strlen(line) < SUDOKU_CELL_COUNT || line[0] == '#')
+      continue;
+
+    int givens = 0;
+    for (int cell = 0; cell < SUDOKU_CELL_COUNT; cell++) {
+      seedPuzzles[seedCount][cell] = line[cell] == '.' ? '0' : (uint8_t)line[cell];
+      givens += seedPuzzles[seedCount][cell] != '0';
+    }
+    // the tier promises 17 clues, other puzzles of the file are skipped
+    board_t board;
+    seedCount += givens == SEED_GIVENS && load_board(seedPuzzles[seedCount], &board);
+  }
+
+  fclose(fp);
+  return seedCount > 0;
+}
+
+static int write_tier(const char *dir, int tier, const uint8_t *puzzles, const uint8_t *solutions, int count) {
+  char path[1024];
+  uint8_t record[BYTES_FOR_1_SUDOKUS];
+  size_t bytes = (size_t)count * SUDOKU_CELL_COUNT;
+
+  snprintf(path, sizeof(path), "%s/%s.csv", dir, tierNames[tier]);
+  FILE *fp = fopen(path, "wb");
+  if (!fp)
+    return 1;
+  fputs("quizzes,solutions\n", fp);
+  for (int i = 0; i < count; i++) {
+    memcpy(record, &puzzles[(size_t)i * SUDOKU_CELL_COUNT], SUDOKU_CELL_COUNT);
+    record[SUDOKU_CELL_COUNT] = ',';
+    memcpy(&record[SUDOKU_CELL_COUNT + 1], &solutions[(size_t)i * SUDOKU_CELL_COUNT], SUDOKU_CELL_COUNT);
+    record[BYTES_FOR_1_SUDOKUS - 1] = '\n';
+    fwrite(record, 1, BYTES_FOR_1_SUDOKUS, fp);
+  }
+  if (fclose(fp))
+    return 1;
+
+  snprintf(path, sizeof(path), "%s/%s.bin", dir, tierNames[tier]);
+  fp = fopen(path, "wb");
+  if (!fp)
+    return 1;
+  int failed = fwrite(puzzles, 1, bytes, fp) != bytes || fwrite(solutions, 1, bytes, fp) != bytes;
+  return fclose(fp) || failed;
+}
+
+static double wall_ms() {
+  struct timespec ts;
+  timespec_get(&ts, TIME_UTC);
+  return (double)ts.tv_sec * 1000 + (double)ts.tv_nsec / 1000000;
+}
+#pragma endregion
@@ -0,0 +1,116 @@
+// Python binding of solve_batch, compiled together with the solver into one extension module:
+//   g++ -O3 -march=native -shared -fPIC -pthread $(python3-config --includes) python/sudokumodule.c
+//       -o sudoku$(python3-config --extension-suffix)
+//
+//   import sudoku, numpy as np
+//   puzzles = np.frombuffer(b"...", np.uint8).reshape(-1, 81)  # '1'..'9', '0' for blanks
+//   solutions = np.empty_like(puzzles)
+//   failed = sudoku.solve_batch(puzzles, solutions, threads=8)
+//
+//   candidates, hints, invalid = sudoku.hint_batch(puzzles)
+//   np.frombuffer(candidates, np.uint16).reshape(-1, 81)  # bit d - 1 while digit d fits a cell
+//   np.frombuffer(hints, np.uint8).reshape(-1, 4)  # kind, cell, digit, unit of the next forced move
+//
+// Any C contiguous buffer works, a uint8[N, 81] array, bytes or a bytearray, and out defaults to a new bytearray. The
+// GIL is released while the batch is solved.
+#define PY_SSIZE_T_CLEAN
+#include "Python.h"
+
+#define SOLVER_LIBRARY
+#include "../solverAvx2.c"
+
+// solve_batch(puzzles, out=None, threads=0) returns the number of puzzles without a solution if out is given, else
+// (out, failed)
+static PyObject *py_solve_batch(PyObject *self, PyObject *args, PyObject *kwargs) {
+  static const char *keywords[] = {"puzzles", "out", "threads", NULL};
+  PyObject *puzzles, *outObject = Py_None, *result = NULL;
+  int threads = 0;
+  Py_buffer in, out;
+  (void)self;
+
+  if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|Oi", (char **)keywords, &puzzles, &outObject, &threads))
+    return NULL;
+  if (threads < 0 || threads > 255) {
+    PyErr_SetString(PyExc_ValueError, "threads must be 0..255");
+    return NULL;
+  }
+  if (PyObject_GetBuffer(puzzles, &in, PyBUF_C_CONTIGUOUS) < 0)
+    return NULL;
+  if (in.len % SUDOKU_CELL_COUNT) {
+    PyErr_SetString(PyExc_ValueError, "puzzles must hold a multiple of 81 bytes");
+    PyBuffer_Release(&in);
+    return NULL;
+  }
+
+  int ownsOut = outObject == Py_None;
+  if (ownsOut && !(outObject = PyByteArray_FromStringAndSize(NULL, in.len))) {
+    PyBuffer_Release(&in);
+    return NULL;
+  }
+  if (PyObject_GetBuffer(outObject, &out, PyBUF_C_CONTIGUOUS | PyBUF_WRITABLE) < 0)
+    goto done;
+
+  if (out.len != in.len) {
+    PyErr_SetString(PyExc_ValueError, "out must be as large as puzzles");
+  } else if ((const uint8_t *)out.buf < (const uint8_t *)in.buf + in.len &&
+             (const uint8_t *)in.buf < (const uint8_t *)out.buf + out.len) {
+    PyErr_SetString(PyExc_ValueError, "out must not overlap puzzles");
+  } else {
+    int64_t failed;
+    Py_BEGIN_ALLOW_THREADS;
+    failed = solve_batch((const uint8_t *)in.buf, (uint8_t *)out.buf, (size_t)(in.len / SUDOKU_CELL_COUNT),
+                         SOLVE_BATCH_THREADS(threads));
+    Py_END_ALLOW_THREADS;
+    result = ownsOut ? Py_BuildValue("(OL)", outObject, (long long)failed) : PyLong_FromLongLong(failed);
+  }
+  PyBuffer_Release(&out);
+
+done:
+  PyBuffer_Release(&in);
+  if (ownsOut)
+    Py_DECREF(outObject);
+  return result;
+}
+
+// hint_batch(puzzles) returns (candidates, hints, invalid), two new bytearrays and the number of invalid boards
+static PyObject *py_hint_batch(PyObject *self, PyObject *args) {
+  PyObject *puzzles, *candidates = NULL, *hints = NULL, *result = NULL;
+  Py_buffer in;
+  (void)self;
+
+  if (!PyArg_ParseTuple(args, "O", &puzzles) || PyObject_GetBuffer(puzzles, &in, PyBUF_C_CONTIGUOUS) < 0)
+    return NULL;
+  if (in.len % SUDOKU_CELL_COUNT) {
+    PyErr_SetString(PyExc_ValueError, "puzzles must hold a multiple of 81 bytes");
+  } else {
+    size_t n = (size_t)(in.len / SUDOKU_CELL_COUNT);
+    candidates = PyByteArray_FromStringAndSize(NULL, (Py_ssize_t)(n * SUDOKU_CELL_COUNT * sizeof(uint16_t)));
+    hints = PyByteArray_FromStringAndSize(NULL, (Py_ssize_t)(n * sizeof(sudoku_hint_t)));
+    if (candidates && hints) {
+      int64_t invalid;
+      Py_BEGIN_ALLOW_THREADS;
+      invalid = hint_batch((const uint8_t *)in.buf, (uint16_t *)PyByteArray_AS_STRING(candidates),
+                           (sudoku_hint_t *)PyByteArray_AS_STRING(hints), n, 0);
+      Py_END_ALLOW_THREADS;
+      result = Py_BuildValue("(OOL)", candidates, hints, (long long)invalid);
+    }
+  }
+
+  PyBuffer_Release(&in);
+  Py_XDECREF(candidates);
+  Py_XDECREF(hints);
+  return result;
+}
+
+static PyMethodDef methods[] = {
+    {"solve_batch", (PyCFunction)(void (*)(void))py_solve_batch, METH_VARARGS | METH_KEYWORDS,
+     "solve_batch(puzzles, out=None, threads=0)\n\nSolves the 81 cell puzzles of a contiguous buffer into out, 81 '0's "
+     "for a puzzle without a solution. Returns the number of those, or (out, failed) when out is not given."},
+    {"hint_batch", (PyCFunction)py_hint_batch, METH_VARARGS,
+     "hint_batch(puzzles)\n\nCandidate masks of every cell, and the next naked or hidden single, of the partial boards "
+     "of a contiguous buffer. Returns (candidates, hints, invalid)."},
+    {NULL, NULL, 0, NULL}};
+
+static struct PyModuleDef module = {PyModuleDef_HEAD_INIT, "sudoku", "Batch sudoku solver", -1, methods};
+
+PyMODINIT_FUNC PyInit_sudoku(void) { return PyModule_Create(&module); }
@@ -210,26 +210,32 @@ void solve()
 #endif
 }
 
-int main()
+// usage: solver2 [input], sudoku.csv by default, every puzzle up to the end of the file is solved
+int main(int argc, char **argv)
 {
   clock_t start = clock();
 
   setup();
 
-  FILE *fp = fopen("sudoku.csv", "r");
+  FILE *fp = fopen(argc > 1 ? argv[1] : "sudoku.csv", "r");
+  if (!fp)
+  {
+    printf("Could not read %s\n", argc > 1 ? argv[1] : "sudoku.csv");
+    return 1;
+  }
 
   unsigned char header[50];
   // "quizzes,solutions\n" = 18
   fread(header, sizeof(char), 18, fp);
 
-  for (unsigned int i = 0; i < 1000000; ++i)
+  for (unsigned int i = 0;; ++i)
   {
 #ifdef LOG_LEVEL
     clock_t startReadInput = clock();
 #endif
 
-    fread(puzzle, sizeof(char), 82, fp);
-    fread(solution, sizeof(char), 82, fp);
+    if (fread(puzzle, sizeof(char), 82, fp) != 82 || fread(solution, sizeof(char), 82, fp) != 82)
+      break;
 
 #ifdef LOG_LEVEL
     timeReadInput += ((double)(clock() - startReadInput) / CLOCKS_PER_SEC);
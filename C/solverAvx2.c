@@ -1,151 +1,942 @@
+#include "solverAvx2.h"
+#include "errno.h"
 #include "immintrin.h"
+#include "pthread.h"
 #include "stdint.h"
 #include "stdio.h"
+#include "stdlib.h"
 #include "string.h"
 #include "time.h"
 
+#ifdef _WIN32
+#include "io.h"
+#include "process.h"
+#else
+#include "arpa/inet.h"
+#include "fcntl.h"
+#include "netinet/in.h"
+#include "spawn.h"
+#include "sys/mman.h"
+#include "sys/socket.h"
+#include "sys/stat.h"
+#include "sys/un.h"
+#include "sys/wait.h"
+#include "unistd.h"
+extern char **environ;
+#endif
+
 // #define TEST
 #define CHECK_SOLUTIONS
+#define VALIDATE_SOLUTIONS
+// prefetch the records of the next block while the current one is solved
+#define PREFETCH_NEXT_BLOCK
+// sweep INTERLEAVED_BLOCKS blocks in lock step, so their independent solve_cell chains fill each other's latency
+#define INTERLEAVE_BLOCKS
+#define INTERLEAVED_BLOCKS 2
+// rdtsc spans in per-thread rings, recorded only when --trace is given
+#define TRACE
+// adapt the full sweeps and the queue length of solve_parallel to the feed, per thread
+#define AUTO_TUNE
+// run singles over BITSLICE_LENGTH puzzles at once, bit sliced, before the 16 lane engine gets the groups left open
+#define BITSLICE_BLOCKS
+// node-local input and scratch for --numa, needs libnuma: g++ -DUSE_NUMA ... -pthread -lnuma
+// #define USE_NUMA
+// gzip input, BGZF members inflated in parallel, needs zlib: g++ -DUSE_ZLIB ... -lz
+// #define USE_ZLIB
+// zstd input, independent frames decompressed in parallel, needs libzstd: g++ -DUSE_ZSTD ... -lzstd
+// #define USE_ZSTD
 
-#define SUDOKU_COUNT 1000000
+#ifdef __linux__
+#include "sched.h"
+#endif
+#ifdef USE_NUMA
+#include "numa.h"
+#endif
+#ifdef USE_ZLIB
+#include "zlib.h"
+#endif
+#ifdef USE_ZSTD
+#include "zstd.h"
+#endif
 
 #define SUDOKU_CELL_COUNT 81
+// kaggle layout: 81 digits, a comma, 81 digits and a newline
 #define BYTES_FOR_1_SUDOKUS 164
-#define BYTES_FOR_2_SUDOKUS 328
-#define BYTES_FOR_3_SUDOKUS 492
-#define BYTES_FOR_4_SUDOKUS 656
-#define BYTES_FOR_5_SUDOKUS 820
-#define BYTES_FOR_6_SUDOKUS 984
-#define BYTES_FOR_7_SUDOKUS 1148
-#define BYTES_FOR_8_SUDOKUS 1312
-#define BYTES_FOR_9_SUDOKUS 1476
-#define BYTES_FOR_A_SUDOKUS 1640
-#define BYTES_FOR_B_SUDOKUS 1804
-#define BYTES_FOR_C_SUDOKUS 1968
-#define BYTES_FOR_D_SUDOKUS 2132
-#define BYTES_FOR_E_SUDOKUS 2296
-#define BYTES_FOR_F_SUDOKUS 2460
+// records normalized by parse_records: 81 cells padded to three 32 byte vectors, written with aligned streaming stores
+#define PACKED_BYTES_FOR_1_SUDOKUS 96
+// transpose8x16 reads 32 bytes from the last 16 cells of a record, normalize_cells reads 96 bytes of a line
+#define INPUT_PADDING 32
 
 #define ROW_OFFSET 1296  // 81 << 4
 #define BOX_OFFSET 1440  // + 9 << 4
 #define COL_OFFSET 1584  // + 9 << 4
 #define DATA_LENGTH 1728 // + 9 << 4
+// units a variant adds on top of the 27, and how many of them a single cell can be part of
+#define MAX_EXTRA_UNITS 16
+#define MAX_CELL_EXTRA_UNITS 4
+// a block's scratch area in the arena: data, the extra units of a variant right after the columns, then the givens
+// and the transformed solutions, 143 cache lines
+#define EXTRA_OFFSET DATA_LENGTH
+#define GIVENS_OFFSET (EXTRA_OFFSET + (MAX_EXTRA_UNITS << 4))
+#define SOLUTION_DATA_OFFSET (GIVENS_OFFSET + (SUDOKU_CELL_COUNT << 4))
+#define BLOCK_SCRATCH_LENGTH (SOLUTION_DATA_OFFSET + (SUDOKU_CELL_COUNT << 4))
+
+// exact cover: 4 constraints per cell (cell, row-digit, col-digit, box-digit) and one per extra unit-digit, 9
+// candidates per cell
+#define DLX_COLUMN_COUNT 468 // 4 * 81 + MAX_EXTRA_UNITS * 9
+#define DLX_NODE_COUNT 6301  // 1 root + 468 headers + (4 + MAX_CELL_EXTRA_UNITS) * 729
+// lanes with at least this many open cells after the queue phase skip solve_single_puzzle and go straight to dlx
+#define DLX_MIN_EMPTY_CELLS 56
+// a block with at most this many puzzles is solved one puzzle at a time by the cross cell engine
+#define CROSS_CELL_MAX_LANES 4
+// puzzles in a bit sliced group, one per bit of a 256 bit register, and the passes it runs at most. After a group
+// that solved none of its blocks of 16, the next 1, 2, 4 .. BITSLICE_MAX_SKIPPED groups skip the bit sliced engine.
+#define BITSLICE_LENGTH 256
+#define BITSLICE_MAX_PASSES 64
+#define BITSLICE_MAX_SKIPPED 64
+
+// blocks between two decisions of the tuner, and the range it moves the sweeps and the queue length in
+#define TUNE_WINDOW_BLOCKS 64
+#define TUNE_MIN_SWEEPS 1
+#define TUNE_MAX_SWEEPS 6
+#define TUNE_MIN_QUEUE_LENGTH (SUDOKU_CELL_COUNT << 1)
+#define TUNE_MAX_QUEUE_LENGTH (SUDOKU_CELL_COUNT << 4)
+
+#define MAX_THREAD_COUNT 256
+// logical cpus --pin looks at, and the hyperthreads of a core it tells apart
+#define MAX_CPU_COUNT 1024
+#define MAX_CORE_THREADS 4
+#define MAX_SHARD_COUNT 256
+// solve_batch hands the caller's puzzles to run in batches of at most this many, so their offsets fit an int
+#define LIBRARY_BATCH_LENGTH (1 << 24)
+// blocks of 16 solved between two checkpoints unless --checkpoint-blocks says otherwise, 1M puzzles
+#define CHECKPOINT_BLOCKS 65536
+
+#define PLACEMENT_NONE 0
+#define PLACEMENT_CORES 1
+#define PLACEMENT_SMT 2
+#define PLACEMENT_PAIR 3
+
+#define COMPRESSION_NONE 0
+#define COMPRESSION_GZIP 1
+#define COMPRESSION_ZSTD 2
+// blocks of 16 solved at a time while a compressed input is still being inflated
+#define INFLATE_SEGMENT_BLOCKS 4096
+
+// service mode: puzzles waiting for a block, puzzles a connection submits at once, bytes read per call
+#define SERVICE_QUEUE_LENGTH 4096
+#define SERVICE_GROUP_LENGTH 256
+#define SERVICE_READ_BYTES 65536
+// power of two microsecond buckets for the wait and latency histograms
+#define SERVICE_LATENCY_BUCKET_COUNT 32
+
+// guesses deeper than this are counted in the last bucket of the histogram
+#define STATS_GUESS_DEPTH_COUNT 32
+
+// spans a thread keeps before the oldest are overwritten, a power of two
+#define TRACE_RING_LENGTH (1 << 20)
+#define TRACE_READ 0
+#define TRACE_PARSE 1
+#define TRACE_TRANSFORM 2
+#define TRACE_SETUP 3
+#define TRACE_SWEEPS 4
+#define TRACE_QUEUE 5
+#define TRACE_SINGLE_PUZZLE 6
+#define TRACE_DLX 7
+#define TRACE_VERIFY 8
+#define TRACE_WRITE 9
+#define TRACE_DEFERRED 10
+#define TRACE_BITSLICE 11
+#define TRACE_PHASE_COUNT 12
+
+// Per puzzle limits on the fallback searches, 0 for none: guesses and dlx choices, and wall clock. A puzzle that runs
+// out is deferred, its lane is left out of the block and solved after the batch, so it does not hold up the others.
+typedef struct {
+  uint64_t nodes;
+  double deadlineMs;
+} budget_t;
+
+// puzzles (and optionally their solutions) laid out at a fixed stride, count is a multiple of 16. output, when set,
+// receives a record per puzzle at outputStride: a kaggle layout record for BYTES_FOR_1_SUDOKUS, the 81 digits of the
+// solution alone for SUDOKU_CELL_COUNT. padding counts the solved grids pad_batch added at the end of the batch.
+typedef struct {
+  const uint8_t *sudokus, *solutions;
+  uint8_t *output;
+  int count, stride, outputStride;
+  budget_t budget;
+  int padding;
+} batch_t;
+
+typedef struct {
+  uint64_t blocks, failedBlocks, rejectedLanes, invalidLanes, overflowBlocks;
+  uint64_t fullSweeps, queueIterations;
+  uint64_t singlePuzzleLanes, dlxLanes, crossCellPuzzles, deferredLanes;
+  // deferred lanes whose solution differs from the expected one, they belong to no block of their own
+  uint64_t failedDeferredLanes;
+  // groups of 16 the bit sliced engine solved on its own
+  uint64_t bitslicedBlocks;
+  uint64_t backtrackBytes;
+  // cycles spent turning records into lanes, where a block's cold input is first read
+  uint64_t transformCycles;
+  // cycles of the slow pass over the deferred lanes
+  uint64_t deferredCycles;
+  // sums over the queue runs of the sweeps and queue length they ran with, and how often the tuner changed them
+  uint64_t tunedBlocks, tunedSweeps, tunedQueueLength, tuneSteps;
+  uint64_t guessDepth[STATS_GUESS_DEPTH_COUNT];
+} solver_stats_t;
+
+typedef struct {
+  __m256i_u *p_r, *p_b, *p_c, *p_p;
+} cell_t;
+
+// Extra units of a variant, each 9 cells that hold every digit once. Their remaining digit masks follow the columns, at
+// EXTRA_OFFSET, outside DATA_LENGTH so the copies of the classic fallbacks stay small. Set up once by init_variant,
+// classic puzzles have no extra units.
+typedef struct {
+  int unitCount;
+  uint8_t unitCells[MAX_EXTRA_UNITS][9];
+  uint8_t cellUnitCount[SUDOKU_CELL_COUNT];
+  uint8_t cellUnits[SUDOKU_CELL_COUNT][MAX_CELL_EXTRA_UNITS];
+} variant_t;
+
+static variant_t variant;
+
+// Where --pin puts the threads of a batch: the cpu of each solver worker and of the inflate worker with the same index,
+// -1 to leave one unpinned. cores gives every solver a physical core of its own, smt puts two on the hyperthreads of a
+// core, pair gives every solver a core and its inflate worker the sibling hyperthread. Set up once by init_placement.
+typedef struct {
+  int mode, coreCount;
+  int solverCpus[MAX_THREAD_COUNT], helperCpus[MAX_THREAD_COUNT];
+} placement_t;
+
+static placement_t placement;
+static const char *placementNames[] = {"none", "cores", "smt", "pair"};
+
+// progress of a batch run with --checkpoint: the puzzles solved and written so far, the length of the output they
+// fill and the stats merged over them. statsSize guards against a checkpoint from a build with other stats.
+typedef struct {
+  char magic[8];
+  uint64_t statsSize, inputLength;
+  int64_t puzzleCount, doneCount;
+  uint64_t outputOffset;
+  solver_stats_t stats;
+} checkpoint_t;
+
+// an independently compressed piece of the input: a BGZF member, a whole gzip file or a zstd frame, and the crc32 of
+// its bytes for gzip
+typedef struct {
+  size_t offset, length, outputOffset, outputLength;
+  uint32_t crc;
+} chunk_t;
+
+// Inflates the chunks of a compressed input on threadCount workers, straight into bytes, the buffer load_batch reads.
+// The first and the last chunk go first, they hold all load_batch looks at of an input it solves in place, then the
+// others in order. readyChunks is the count of leading chunks that are done, which the solver waits on.
+typedef struct {
+  const uint8_t *compressed;
+  int format, raw, chunkCount, chunkCapacity, nextChunk, readyChunks, failed, threadCount, startedThreads;
+  chunk_t *chunks;
+  uint8_t *bytes, *done;
+  size_t length;
+  pthread_mutex_t lock;
+  pthread_cond_t ready;
+  pthread_t threads[MAX_THREAD_COUNT];
+} inflater_t;
+
+// Candidates of BITSLICE_LENGTH puzzles, bit sliced: bit k of cand[c][d] is set while digit d + 1 is possible in cell c
+// of puzzle k. units holds the digits placed in each row, column and box, then their hidden singles.
+typedef struct {
+  __m256i cand[SUDOKU_CELL_COUNT][9];
+  __m256i single[SUDOKU_CELL_COUNT];
+  __m256i units[27][9];
+} bitslice_t;
+
+// The sweeps before the queue and the queue length, tuned per thread from the queue runs of a window of blocks. An
+// overflowing queue that still solved cells in its last quarter was cut short, one that solved nothing in its second
+// half only spun on lanes that need a guess: when most overflows are the former the queue doubles, when most are the
+// latter it halves. Blocks that finish in the queue with more than two sweeps of work left get another sweep, with
+// less than half a sweep they give one back. The counters are halved after each decision, so older windows fade out.
+typedef struct {
+  int sweeps, queueLength;
+  int blocks, overflows, cutShort, spinning, finished;
+  uint64_t finishedIterations;
+} tuner_t;
+
+static __thread tuner_t tuner = {3, TUNE_MIN_QUEUE_LENGTH};
 
 #pragma region function declerations
-static void run(const uint8_t *bytes);
-static void solve16sudokus(const uint8_t *sudokus, uint16_t *data);
+static uint8_t *read_input(const char *path, long rangeStart, long rangeEnd, size_t *length);
+static int load_batch(uint8_t *bytes, size_t length, int skipHeader, batch_t *batch);
+static int kaggle_layout(const uint8_t *bytes, size_t length, int skipHeader, size_t *start);
+static size_t parse_records(const uint8_t *bytes, size_t length, uint8_t *puzzles, uint8_t *solutions,
+                            size_t *solutionCount);
+static int parse_line(const uint8_t *line, size_t lineLength, uint8_t *puzzle, uint8_t *solution,
+                      size_t *solutionCount);
+static size_t find_newline(const uint8_t *bytes, size_t pos, size_t length);
+static size_t count_lines(const uint8_t *bytes, size_t length);
+static void normalize_cells(const uint8_t *src, uint8_t *dest);
+static void pad_batch(uint8_t *sudokus, uint8_t *solutions, int count, int stride, int kaggleLayout);
+
+static void run(const batch_t *batch, uint16_t *data, solver_stats_t *stats);
+static void solve_range(const batch_t *batch, int start, int end, uint16_t *data, solver_stats_t *stats);
+static void run_threaded(const batch_t *batch, int threadCount, int numa, solver_stats_t *stats);
+static void run_library_batch(const batch_t *batch, int threadCount, solver_stats_t *stats);
+static uint16_t hint_block(const uint8_t *sudokus, int count, uint16_t *candidates, sudoku_hint_t *hints,
+                           uint16_t *data);
+static void *solve_worker(void *arg);
+static void *copy_partition(void *arg);
+static uint16_t solve16sudokus(const uint8_t *sudokus, const uint8_t *solutions, int stride, uint8_t *output,
+                               int outputStride, uint16_t *data, solver_stats_t *stats);
+static void solve_interleaved_blocks(const uint8_t *sudokus, const uint8_t *solutions, int stride, uint8_t *output,
+                                     int outputStride, uint16_t *data, solver_stats_t *stats);
+static uint16_t prepare_block(const uint8_t *sudokus, int stride, uint16_t *data, int *r2b, solver_stats_t *stats);
+static uint16_t finish_block(const uint8_t *sudokus, const uint8_t *solutions, int stride, uint8_t *output,
+                             int outputStride, uint16_t *data, int *r2b, uint16_t failed, uint16_t deferred,
+                             solver_stats_t *stats);
+
+static int run_sharded(const char *self, const char *inputPath, const char *outputPath, int shardCount,
+                       int threadCount, int numa, const budget_t *budget, const char *variantSpec,
+                       solver_stats_t *stats);
+static int append_unsolved(FILE *dest, const char *inputPath, long start, long end);
+static void shard_bounds(FILE *fp, long length, int shardCount, long *bounds);
+static intptr_t spawn_process(char **args);
+static int wait_process(intptr_t process);
+static int append_file(FILE *dest, const char *path);
+
+static int compression_format(const uint8_t *bytes, size_t length);
+static int compressed_file(const char *path);
+static int start_inflate(const uint8_t *compressed, size_t length, int threadCount, inflater_t *inflater);
+static int find_gzip_chunks(inflater_t *inflater, size_t length);
+#if defined(USE_ZLIB) || defined(USE_ZSTD)
+static int add_chunk(inflater_t *inflater, size_t offset, size_t length, size_t outputLength, uint32_t crc);
+#endif
+static int find_zstd_chunks(inflater_t *inflater, size_t length);
+static void *inflate_worker(void *arg);
+static int wait_inflated(inflater_t *inflater, size_t end);
+static int finish_inflate(inflater_t *inflater);
+static void run_inflating(const batch_t *batch, inflater_t *inflater, int threadCount, int numa,
+                          solver_stats_t *stats);
+
+static int run_checkpointed(const batch_t *batch, int sudokuCount, size_t inputLength, const char *outputPath,
+                            const char *checkpointPath, int segmentBlocks, int resume, int threadCount, int numa,
+                            solver_stats_t *stats);
+static int read_checkpoint(const char *path, checkpoint_t *checkpoint);
+static int write_checkpoint(const char *path, const checkpoint_t *checkpoint);
+static int sync_file(FILE *fp);
+static int truncate_file(const char *path, uint64_t length);
+
+static int run_filling(const char *inputPath, const char *outputPath, const budget_t *budget, int threadCount, int numa,
+                       solver_stats_t *stats);
+static int copy_file(const char *src, const char *dest);
+
+static int run_service(const char *address, int threadCount, double maxWaitMs);
+static void *service_worker(void *arg);
+static void *service_connection(void *arg);
+static void solve_service_group(const uint8_t *records, uint8_t *replies, int count);
+static int format_service_stats(char *text, size_t size);
+static int write_all(int fd, const void *bytes, size_t length);
 
-static void transform_sudokus(const uint8_t *sudokus, uint16_t *data);
-static void transpose8x16(const uint8_t *p_src, uint16_t *p_dest);
+static uint16_t transform_sudokus(const uint8_t *sudokus, int stride, uint16_t *data);
+static void transpose8x16(const uint8_t *p_src, int stride, uint16_t *p_dest, __m256i_u *badCharVec);
+static void check_chars(__m256i_u *charVec, __m256i_u *zeroCharVec, __m256i_u *nineCharVec, __m256i_u *badCharVec);
 static void convert2base2(__m256i_u *cellVec, __m256i_u *nineCharVec, __m256i_u *nineBitVec);
 
-static void setup_step(uint16_t *data, int *r2b);
-static void solve_parallel(uint16_t *data, int *r2b);
+static void write_solutions(const uint8_t *sudokus, int stride, const uint16_t *data, uint16_t failed,
+                            uint8_t *output, int outputStride);
+static void untransform_sudokus(const uint16_t *data, uint8_t *dest, int stride);
+static __m128i cells_to_chars(__m256i_u cellVec);
+static void transpose16x16(__m128i *rows);
+
+static uint16_t solve_block(const uint8_t *sudokus, int stride, int count, uint8_t *output, uint16_t *data,
+                            solver_stats_t *stats);
+static uint16_t solve_cross_cell_lanes(const uint8_t *sudokus, const uint8_t *solutions, int stride, int count,
+                                       uint8_t *output, int outputStride, solver_stats_t *stats);
+static int solve_cross_cells(const uint8_t *puzzle, uint8_t *solution);
+static int try_bitsliced();
+static void solve_bitsliced(const batch_t *batch, int start, int count, uint16_t *data, solver_stats_t *stats);
+static __m256i transform_bitsliced(const uint8_t *sudokus, int stride, int groupCount, bitslice_t *slices);
+static __m256i propagate_bitsliced(bitslice_t *slices);
+static int bitslice_unit_cell(int u, int j);
+static void untransform_bitsliced(const bitslice_t *slices, int group, uint8_t *dest, int stride);
+static __m128i lane_bits_to_bytes(uint32_t mask);
+static int propagate_cross_cells(__m256i_u *rows);
+static int search_cross_cells(__m256i_u *rows);
+
+static uint16_t setup_step(uint16_t *data, int *r2b);
+static int init_variant(const char *spec);
+static int add_extra_unit(const int *cells);
+static uint16_t setup_extra_units(uint16_t *data);
+static uint16_t solve_parallel_variant(uint16_t *data, int *r2b, solver_stats_t *stats);
+static uint16_t validate_extra_units(const uint16_t *data);
+static uint16_t extra_candidates(const uint16_t *p_extras, int p);
+static void reject_lanes(uint16_t *data, uint16_t mask);
+static uint16_t solve_parallel(uint16_t *data, int *r2b, solver_stats_t *stats);
+static void solve_parallel_interleaved(uint16_t **blocks, int *r2b, uint16_t *deferred, solver_stats_t *stats);
+static uint16_t run_queue(cell_t *queue, int qEnd, uint16_t *data, int *r2b, solver_stats_t *stats);
+static void tune_queue_run(int qIdx, int lastProgress, int overflowed, solver_stats_t *stats);
 static void solve_cell(__m256i_u *pVec, __m256i_u *rVec, __m256i_u *bVec, __m256i_u *cVec, __m256i_u *zeroVec,
                        __m256i_u *oneVec);
-static char solve_single_puzzle(uint16_t *data, int *r2b, int puzzleOffset);
+static char solve_single_puzzle(uint16_t *data, int *r2b, int puzzleOffset, solver_stats_t *stats, int depth);
+
+static uint16_t route_unsolved_lanes(uint16_t *data, int *r2b, solver_stats_t *stats);
+static char dlx_solve_puzzle(uint16_t *data, int puzzleOffset);
+
+static void set_lane_budget(const budget_t *budget);
+static void start_lane_budget();
+static int spend_budget_node();
+static uint16_t defer_lanes(const uint8_t *sudokus, const uint8_t *solutions, int stride, uint8_t *output,
+                            int outputStride, uint16_t deferred);
+static void solve_deferred_lanes(solver_stats_t *stats);
 
-static void check_solutions(uint16_t *data, uint16_t *solutions);
+static void check_solutions(uint16_t *data, uint16_t *solutions, uint16_t skipped, solver_stats_t *stats);
+static uint16_t validate_solutions(const uint16_t *data, const uint16_t *givens, int *r2b);
+static uint16_t lane_mask(__m256i_u vec);
+static __m256i_u lane_vec(uint16_t mask);
+static __m256i load_cells(const void *p);
+static void store_cells(void *p, __m256i vec);
+static uint16_t *alloc_block_arena(int areaCount, int node);
+static void free_block_arena(uint16_t *arena, int areaCount, int node);
+static void prefetch_block(const uint8_t *sudokus, const uint8_t *solutions, int stride);
 
-static void test_transform_sudokus(const uint8_t *sudokus, uint16_t *data);
+static void enable_trace();
+static uint64_t trace_begin();
+static void trace_end(int phase, uint64_t start);
+static void trace_span(int phase, uint64_t start, uint64_t end);
+static int write_trace_json(const char *path);
+
+static void merge_stats(solver_stats_t *dest, const solver_stats_t *src);
+static void print_stats(const solver_stats_t *stats);
+static void write_stats_json(FILE *fp, const solver_stats_t *stats);
+
+static void test_transform_sudokus(const uint8_t *sudokus, int stride, uint16_t *data);
 static void test_setup_step(uint16_t *data);
 
+static int numa_node_count();
+static void bind_to_node(int node);
+static void *alloc_on_node(size_t size, int node);
+static void free_on_node(void *p, size_t size, int node);
+
+static int init_placement(const char *spec, int threadCount);
+static int topology_id(int cpu, const char *name);
+static void pin_thread(int helper, int index);
+static void print_placement(int threadCount);
+
 static void print_sudoku(uint16_t *data, int puzzleOffset);
-static double time_ms(const clock_t start, const clock_t end);
+static double wall_ms();
 #pragma endregion
 
-int failedCount = 0;
-uint64_t queueLengthTotal = 0;
+// usage: solverAvx2 [--threads <n>] [--numa] [--shards <n>] [--output <file>] [--stats-json <file>] [input], "-"
+// writes the json to stdout. --range <start> <end>, --stats-bin <file> and --quiet are what a shard process runs with.
+// solverAvx2 --serve <socket path|port> [--max-wait-us <n>] [--threads <n>] runs the solver service instead, and
+// solverAvx2 --puzzle <81 cells> solves a single puzzle with the cross cell engine. --budget <nodes> and --deadline-us
+// <n> limit the search of each puzzle in a batch, the puzzles over the limit are solved after the others. --trace
+// <file> writes the phases of every block as a chrome trace. --variant <x,windoku,disjoint> adds the diagonals, the
+// four windows or the nine disjoint groups as units. --checkpoint <file> [--checkpoint-blocks <n>] writes the output and
+// a checkpoint every n blocks of 16, and --resume continues a killed run from its checkpoint, appending to the output.
+// A gzip (USE_ZLIB) or zstd (USE_ZSTD) input is inflated on --threads workers while it is solved. --pin <none|cores|
+// smt|pair> pins the workers of a batch: one per physical core, two per core, or one per core with its inflate worker
+// on the sibling hyperthread. --fill writes the solutions into the solution column of a kaggle layout input in place,
+// or of a copy of it at --output.
+#ifndef SOLVER_LIBRARY
+int main(int argc, char **argv) {
+  const char *inputPath = "../sudoku.csv", *statsJsonPath = NULL, *statsBinPath = NULL, *outputPath = NULL;
+  const char *serveAddress = NULL, *puzzle = NULL, *tracePath = NULL, *variantSpec = NULL, *checkpointPath = NULL;
+  const char *placementSpec = NULL;
+  int threadCount = 1, numa = 0, shardCount = 1, quiet = 0, maxWaitUs = 1000;
+  int checkpointBlocks = CHECKPOINT_BLOCKS, resume = 0, fill = 0;
+  long rangeStart = 0, rangeEnd = -1;
+  budget_t budget = {0, 0};
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "--stats-json") && i + 1 < argc)
+      statsJsonPath = argv[++i];
+    else if (!strcmp(argv[i], "--stats-bin") && i + 1 < argc)
+      statsBinPath = argv[++i];
+    else if (!strcmp(argv[i], "--output") && i + 1 < argc)
+      outputPath = argv[++i];
+    else if (!strcmp(argv[i], "--threads") && i + 1 < argc)
+      threadCount = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "--shards") && i + 1 < argc)
+      shardCount = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "--serve") && i + 1 < argc)
+      serveAddress = argv[++i];
+    else if (!strcmp(argv[i], "--max-wait-us") && i + 1 < argc)
+      maxWaitUs = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "--puzzle") && i + 1 < argc)
+      puzzle = argv[++i];
+    else if (!strcmp(argv[i], "--budget") && i + 1 < argc)
+      budget.nodes = strtoull(argv[++i], NULL, 10);
+    else if (!strcmp(argv[i], "--deadline-us") && i + 1 < argc)
+      budget.deadlineMs = atof(argv[++i]) / 1000;
+    else if (!strcmp(argv[i], "--trace") && i + 1 < argc)
+      tracePath = argv[++i];
+    else if (!strcmp(argv[i], "--variant") && i + 1 < argc)
+      variantSpec = argv[++i];
+    else if (!strcmp(argv[i], "--checkpoint") && i + 1 < argc)
+      checkpointPath = argv[++i];
+    else if (!strcmp(argv[i], "--checkpoint-blocks") && i + 1 < argc)
+      checkpointBlocks = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "--resume"))
+      resume = 1;
+    else if (!strcmp(argv[i], "--pin") && i + 1 < argc)
+      placementSpec = argv[++i];
+    else if (!strcmp(argv[i], "--fill"))
+      fill = 1;
+    else if (!strcmp(argv[i], "--range") && i + 2 < argc) {
+      rangeStart = atol(argv[++i]);
+      rangeEnd = atol(argv[++i]);
+    } else if (!strcmp(argv[i], "--numa"))
+      numa = 1;
+    else if (!strcmp(argv[i], "--quiet"))
+      quiet = 1;
+    else
+      inputPath = argv[i];
+  }
+  threadCount = threadCount < 1 ? 1 : threadCount > MAX_THREAD_COUNT ? MAX_THREAD_COUNT : threadCount;
+  if (variantSpec && !init_variant(variantSpec)) {
+    printf("Invalid variant %s, expected each of x, windoku and disjoint at most once\n", variantSpec);
+    return 1;
+  }
+  shardCount = shardCount < 1 ? 1 : shardCount > MAX_SHARD_COUNT ? MAX_SHARD_COUNT : shardCount;
+  checkpointBlocks = checkpointBlocks < 1 ? 1 : checkpointBlocks;
+  if (fill && (shardCount > 1 || checkpointPath || rangeStart || rangeEnd >= 0 || compressed_file(inputPath))) {
+    printf("--fill solves a whole uncompressed input in one process, without --checkpoint\n");
+    return 1;
+  }
+  if (shardCount > 1 && compressed_file(inputPath)) {
+    printf("--shards needs an uncompressed input\n");
+    return 1;
+  }
+  if ((checkpointPath || resume) && (!checkpointPath || shardCount > 1)) {
+    printf("--resume needs --checkpoint, which runs in a single process\n");
+    return 1;
+  }
+  // the spans are recorded by the shard processes, which would all write the same file
+  if (tracePath && shardCount > 1) {
+    printf("--trace records a single process, without --shards\n");
+    return 1;
+  }
+  // the shards would all pin to the same cpus, and --numa binds the workers to nodes itself
+  if (placementSpec && (shardCount > 1 || numa)) {
+    printf("--pin places the threads of a single process, without --numa\n");
+    return 1;
+  }
+  if (placementSpec && !init_placement(placementSpec, threadCount)) {
+    printf("Unknown placement %s, expected none, cores, smt or pair\n", placementSpec);
+    return 1;
+  }
+
+  if (serveAddress)
+    return run_service(serveAddress, threadCount, (maxWaitUs < 0 ? 0 : maxWaitUs) / 1000.0);
 
-int main() {
-  clock_t start = clock();
+  if (puzzle && variant.unitCount) {
+    printf("--puzzle solves classic puzzles only\n");
+    return 1;
+  } else if (puzzle) {
+    // normalize_cells reads and streams whole vectors, so the argument goes through an aligned, zero padded copy
+    alignas(32) uint8_t line[PACKED_BYTES_FOR_1_SUDOKUS] = {0};
+    alignas(32) uint8_t cells[PACKED_BYTES_FOR_1_SUDOKUS];
+    uint8_t solution[SUDOKU_CELL_COUNT + 1] = {0};
+    size_t solutionCount;
+    int puzzleLength = (int)strlen(puzzle);
+    if (puzzleLength == SUDOKU_CELL_COUNT)
+      memcpy(line, puzzle, SUDOKU_CELL_COUNT);
+    if (puzzleLength != SUDOKU_CELL_COUNT || !parse_line(line, SUDOKU_CELL_COUNT, cells, solution, &solutionCount)) {
+      printf("Expected 81 cells\n");
+      return 1;
+    }
 
-  uint8_t *bytes = (uint8_t *)malloc(SUDOKU_COUNT * BYTES_FOR_1_SUDOKUS * sizeof(uint8_t));
-  FILE *fp = fopen("../sudoku.csv", "r");
+    // repeated so the time per solve is above the clock resolution
+    int solved = 0, repeatCount = 1000;
+    double start = wall_ms();
+    for (int i = 0; i < repeatCount; i++)
+      solved = solve_cross_cells(cells, solution);
+    double end = wall_ms();
 
-  fread(bytes, sizeof(uint8_t), SUDOKU_COUNT * BYTES_FOR_1_SUDOKUS, fp);
+    printf("%s\n", solved ? (const char *)solution : "No solution");
+    printf("Solving 1 sudoku took: %.0fns\n", (end - start) * 1000000 / repeatCount);
+    return !solved;
+  }
 
-  fclose(fp);
+  solver_stats_t stats = {0};
+  double start, end;
+  int status = 0;
+  if (tracePath)
+    enable_trace();
 
-  clock_t end = clock();
-  printf("Reading input took: %.0fms\n", time_ms(start, end));
+  if (shardCount > 1) {
+    start = wall_ms();
+    int failedShards = run_sharded(argv[0], inputPath, outputPath, shardCount, threadCount, numa, &budget, variantSpec,
+                                   &stats);
+    end = wall_ms();
+    printf("Solving %d shards took: %.0fms\n", shardCount, end - start);
+    print_stats(&stats);
+    if (failedShards)
+      printf("Failed shards: %d\n", failedShards);
+    status = failedShards != 0;
+  } else if (fill) {
+    // the workers of run_threaded pin themselves, a single solver is the main thread
+    if (threadCount == 1)
+      pin_thread(0, 0);
+    if (placement.mode && !quiet)
+      print_placement(threadCount);
 
-  start = clock();
-  run(bytes);
-  end = clock();
-  printf("Solving 1.000.000 sudokus took: %.0fms\n", time_ms(start, end));
-  printf("Failed: %d\n", failedCount);
+    start = wall_ms();
+    int sudokuCount = run_filling(inputPath, outputPath, &budget, threadCount, numa, &stats);
+    end = wall_ms();
+    if (sudokuCount < 0)
+      return 1;
+    if (!quiet) {
+      printf("Solving %d sudokus took: %.0fms (filled in place)\n", sudokuCount, end - start);
+      print_stats(&stats);
+    }
+  } else {
+    start = wall_ms();
+    if (placement.mode && !quiet)
+      print_placement(threadCount);
 
-  printf("Full iterations: %d\n", (1000000 >> 4) * 3 * SUDOKU_CELL_COUNT);
-  printf("Queue iterations: %d\n", queueLengthTotal);
+    size_t length;
+    uint64_t traceStart = trace_begin();
+    uint8_t *bytes = read_input(inputPath, rangeStart, rangeEnd, &length);
+    trace_end(TRACE_READ, traceStart);
+    if (!bytes) {
+      printf("Could not read %s\n", inputPath);
+      return 1;
+    }
 
-  return 0;
+    // a compressed input is inflated by threadCount workers while the solver starts on the bytes that are ready
+    double inputStart = start;
+    size_t compressedLength = length, recordsStart;
+    int format = compression_format(bytes, length);
+    inflater_t inflater;
+    if (format != COMPRESSION_NONE) {
+      if (rangeStart || rangeEnd >= 0) {
+        printf("--range needs an uncompressed input\n");
+        return 1;
+      }
+      // load_batch skips a header of up to 64KB before its bytes are there
+      if (start_inflate(bytes, length, threadCount, &inflater) ||
+          wait_inflated(&inflater, inflater.length < (1 << 16) ? inflater.length : (1 << 16))) {
+        printf("Could not inflate %s\n", inputPath);
+        return 1;
+      }
+      bytes = inflater.bytes;
+      length = inflater.length;
+    }
+    // a single solver is the main thread, pinned only now so the inflate workers do not inherit its cpu
+    if (threadCount == 1)
+      pin_thread(0, 0);
+
+    end = wall_ms();
+    if (!quiet)
+      printf("Reading input took: %.0fms\n", end - start);
+
+    start = wall_ms();
+    batch_t batch;
+    traceStart = trace_begin();
+    // only an input solved in place can be solved while it is inflated
+    if (format != COMPRESSION_NONE && (checkpointPath || !kaggle_layout(bytes, length, rangeStart == 0, &recordsStart)) &&
+        wait_inflated(&inflater, length)) {
+      printf("Could not inflate %s\n", inputPath);
+      return 1;
+    }
+    int sudokuCount = load_batch(bytes, length, rangeStart == 0, &batch);
+    trace_end(TRACE_PARSE, traceStart);
+    end = wall_ms();
+    if (!quiet)
+      printf("Parsing input took: %.0fms (%s)\n", end - start,
+             batch.stride == BYTES_FOR_1_SUDOKUS ? "kaggle layout" : "normalized");
+
+    batch.output = outputPath && !checkpointPath ? (uint8_t *)_mm_malloc((size_t)batch.count * BYTES_FOR_1_SUDOKUS, 64)
+                                                 : NULL;
+    batch.budget = budget;
+
+    start = wall_ms();
+    if (checkpointPath) {
+      if (run_checkpointed(&batch, sudokuCount, length, outputPath, checkpointPath, checkpointBlocks, resume,
+                           threadCount, numa, &stats))
+        return 1;
+    } else if (format != COMPRESSION_NONE) {
+      run_inflating(&batch, &inflater, threadCount, numa, &stats);
+    } else if (threadCount == 1 && !numa) {
+      uint16_t *arena = alloc_block_arena(INTERLEAVED_BLOCKS, -1);
+      run(&batch, arena, &stats);
+      free_block_arena(arena, INTERLEAVED_BLOCKS, -1);
+    } else {
+      run_threaded(&batch, threadCount, numa, &stats);
+    }
+    end = wall_ms();
+    if (format != COMPRESSION_NONE && finish_inflate(&inflater)) {
+      printf("Could not inflate %s\n", inputPath);
+      return 1;
+    }
+    if (!quiet) {
+      printf("Solving %d sudokus took: %.0fms\n", sudokuCount, end - start);
+      if (format != COMPRESSION_NONE)
+        printf("Input: %.1fMB inflated from %.1fMB, %.0fMB/s from reading to solved\n", length / 1e6,
+               compressedLength / 1e6, length / 1e3 / (end - inputStart));
+      print_stats(&stats);
+    }
+
+    if (batch.output) {
+      FILE *fp = fopen(outputPath, "wb");
+      size_t outputBytes = (size_t)sudokuCount * BYTES_FOR_1_SUDOKUS;
+      if (!fp || fwrite(batch.output, 1, outputBytes, fp) != outputBytes) {
+        printf("Could not write %s\n", outputPath);
+        return 1;
+      }
+      fclose(fp);
+    }
+  }
+
+  if (tracePath && write_trace_json(tracePath)) {
+    printf("Could not write %s\n", tracePath);
+    return 1;
+  }
+
+  if (statsBinPath) {
+    FILE *fp = fopen(statsBinPath, "wb");
+    if (!fp || fwrite(&stats, sizeof(stats), 1, fp) != 1)
+      return 1;
+    fclose(fp);
+  }
+
+  if (statsJsonPath) {
+    FILE *fp = strcmp(statsJsonPath, "-") ? fopen(statsJsonPath, "w") : stdout;
+    if (!fp) {
+      printf("Could not write %s: %s\n", statsJsonPath, strerror(errno));
+      return 1;
+    }
+    write_stats_json(fp, &stats);
+    if (fp != stdout)
+      fclose(fp);
+  }
+
+  return status;
+}
+#endif
+
+// data holds INTERLEAVED_BLOCKS scratch areas of the block arena
+static void run(const batch_t *batch, uint16_t *data, solver_stats_t *stats) {
+  set_lane_budget(&batch->budget);
+  // a last block of a few puzzles and mostly padding is solved a puzzle at a time
+  int count = batch->count, tail = 16 - batch->padding;
+  if (tail <= CROSS_CELL_MAX_LANES && !variant.unitCount)
+    count -= 16;
+
+#ifdef BITSLICE_BLOCKS
+  for (int i = 0; i < count; i += BITSLICE_LENGTH) {
+    int end = count - i < BITSLICE_LENGTH ? count : i + BITSLICE_LENGTH;
+    if (variant.unitCount || !try_bitsliced())
+      solve_range(batch, i, end, data, stats);
+    else
+      solve_bitsliced(batch, i, end - i, data, stats);
+  }
+#else
+  solve_range(batch, 0, count, data, stats);
+#endif
+
+  if (count < batch->count) {
+    int stride = batch->stride;
+    solve_cross_cell_lanes(&batch->sudokus[count * stride], batch->solutions ? &batch->solutions[count * stride] : NULL,
+                           stride, tail, batch->output ? &batch->output[(size_t)count * batch->outputStride] : NULL,
+                           batch->outputStride, stats);
+  }
+
+  solve_deferred_lanes(stats);
+}
+
+// solves the puzzles start..end of a batch in blocks of 16
+static void solve_range(const batch_t *batch, int start, int end, uint16_t *data, solver_stats_t *stats) {
+  int stride = batch->stride, i = start;
+
+#ifdef INTERLEAVE_BLOCKS
+  for (; i + (16 * INTERLEAVED_BLOCKS) <= end; i += 16 * INTERLEAVED_BLOCKS) {
+    const uint8_t *solutions = batch->solutions ? &batch->solutions[i * stride] : NULL;
+    uint8_t *output = batch->output ? &batch->output[(size_t)i * batch->outputStride] : NULL;
+#ifdef PREFETCH_NEXT_BLOCK
+    for (int j = 16 * INTERLEAVED_BLOCKS; j < 32 * INTERLEAVED_BLOCKS && i + j < batch->count; j += 16)
+      prefetch_block(&batch->sudokus[(i + j) * stride], solutions ? &solutions[j * stride] : NULL, stride);
+#endif
+    solve_interleaved_blocks(&batch->sudokus[i * stride], solutions, stride, output, batch->outputStride, data, stats);
+  }
+#endif
+
+  for (; i < end; i += 16) {
+    const uint8_t *solutions = batch->solutions ? &batch->solutions[i * stride] : NULL;
+    uint8_t *output = batch->output ? &batch->output[(size_t)i * batch->outputStride] : NULL;
+#ifdef PREFETCH_NEXT_BLOCK
+    if (i + 16 < batch->count)
+      prefetch_block(&batch->sudokus[(i + 16) * stride], solutions ? &solutions[16 * stride] : NULL, stride);
+#endif
+    solve16sudokus(&batch->sudokus[i * stride], solutions, stride, output, batch->outputStride, data, stats);
+  }
 }
 
-static void run(const uint8_t *bytes) {
-  static uint16_t data[DATA_LENGTH];
+// returns a bit per lane that was rejected as malformed or contradictory, or that failed validation
+static uint16_t solve16sudokus(const uint8_t *sudokus, const uint8_t *solutions, int stride, uint8_t *output,
+                               int outputStride, uint16_t *data, solver_stats_t *stats) {
+  static int r2b[9] = {0, 0, 0, 3, 3, 3, 6, 6, 6};
+
+  uint16_t failed = prepare_block(sudokus, stride, data, r2b, stats);
+  uint16_t deferred = variant.unitCount ? solve_parallel_variant(data, r2b, stats) : solve_parallel(data, r2b, stats);
+  ++stats->blocks;
+  return finish_block(sudokus, solutions, stride, output, outputStride, data, r2b, failed, deferred, stats);
+}
+
+// solves INTERLEAVED_BLOCKS consecutive blocks of 16, data holds a scratch area for each
+static void solve_interleaved_blocks(const uint8_t *sudokus, const uint8_t *solutions, int stride, uint8_t *output,
+                                     int outputStride, uint16_t *data, solver_stats_t *stats) {
+  static int r2b[9] = {0, 0, 0, 3, 3, 3, 6, 6, 6};
+  uint16_t *blocks[INTERLEAVED_BLOCKS], failed[INTERLEAVED_BLOCKS], deferred[INTERLEAVED_BLOCKS];
+  int k;
+
+  for (k = 0; k < INTERLEAVED_BLOCKS; k++) {
+    blocks[k] = &data[k * BLOCK_SCRATCH_LENGTH];
+    failed[k] = prepare_block(&sudokus[k * 16 * stride], stride, blocks[k], r2b, stats);
+  }
+
+  if (variant.unitCount) {
+    for (k = 0; k < INTERLEAVED_BLOCKS; k++)
+      deferred[k] = solve_parallel_variant(blocks[k], r2b, stats);
+  } else {
+    solve_parallel_interleaved(blocks, r2b, deferred, stats);
+  }
+  stats->blocks += INTERLEAVED_BLOCKS;
 
-  for (int i = 0; i < SUDOKU_COUNT; i += 16) {
-    solve16sudokus(&bytes[i * BYTES_FOR_1_SUDOKUS], data);
+  for (k = 0; k < INTERLEAVED_BLOCKS; k++) {
+    finish_block(&sudokus[k * 16 * stride], solutions ? &solutions[k * 16 * stride] : NULL, stride,
+                 output ? &output[k * 16 * outputStride] : NULL, outputStride, blocks[k], r2b, failed[k], deferred[k],
+                 stats);
   }
 }
 
-static void solve16sudokus(const uint8_t *sudokus, uint16_t *data) {
-  transform_sudokus(sudokus, data);
+// transforms a block into its scratch area and sets up the units, returns the rejected lanes
+static uint16_t prepare_block(const uint8_t *sudokus, int stride, uint16_t *data, int *r2b, solver_stats_t *stats) {
+  uint64_t transformStart = __rdtsc();
+  uint16_t failed = transform_sudokus(sudokus, stride, data);
+  // kaggle_layout only looks at the first record, a later one may still use '.' blanks
+  if (failed && stride == BYTES_FOR_1_SUDOKUS) {
+    alignas(32) uint8_t packed[16 * PACKED_BYTES_FOR_1_SUDOKUS];
+    for (int i = 0; i < 16; i++)
+      normalize_cells(&sudokus[i * stride], &packed[i * PACKED_BYTES_FOR_1_SUDOKUS]);
+    failed = transform_sudokus(packed, PACKED_BYTES_FOR_1_SUDOKUS, data);
+  }
+  uint64_t transformEnd = __rdtsc();
+  stats->transformCycles += transformEnd - transformStart;
+  trace_span(TRACE_TRANSFORM, transformStart, transformEnd);
 #ifdef TEST
-  test_transform_sudokus(sudokus, data);
+  test_transform_sudokus(sudokus, stride, data);
 #endif
 
-  static int r2b[9] = {0, 0, 0, 3, 3, 3, 6, 6, 6};
+#ifdef VALIDATE_SOLUTIONS
+  memcpy(&data[GIVENS_OFFSET], data, (SUDOKU_CELL_COUNT << 4) * sizeof(uint16_t));
+#endif
 
-  setup_step(data, r2b);
+  uint64_t traceStart = trace_begin();
+  failed |= setup_step(data, r2b);
+  if (variant.unitCount)
+    failed |= setup_extra_units(data);
 #ifdef TEST
   test_setup_step(data);
 #endif
 
-  solve_parallel(data, r2b);
+  if (failed) {
+    reject_lanes(data, failed);
+    stats->rejectedLanes += _mm_popcnt_u32(failed);
+  }
+  trace_end(TRACE_SETUP, traceStart);
+
+  return failed;
+}
 
+// checks and validates a solved block and writes its output, returns failed with the invalid lanes added. Deferred
+// lanes are left unsolved, they are checked and written by the slow pass.
+static uint16_t finish_block(const uint8_t *sudokus, const uint8_t *solutions, int stride, uint8_t *output,
+                             int outputStride, uint16_t *data, int *r2b, uint16_t failed, uint16_t deferred,
+                             solver_stats_t *stats) {
+  uint64_t traceStart = trace_begin();
 #ifdef CHECK_SOLUTIONS
-  static uint16_t solutions[SUDOKU_CELL_COUNT << 4];
-  transform_sudokus(&sudokus[SUDOKU_CELL_COUNT + 1], solutions);
-  check_solutions(data, solutions);
+  if (solutions) {
+    uint16_t *solutionData = &data[SOLUTION_DATA_OFFSET];
+    transform_sudokus(solutions, stride, solutionData);
+    check_solutions(data, solutionData, deferred, stats);
+  }
 #endif
+
+#ifdef VALIDATE_SOLUTIONS
+  uint16_t invalid = validate_solutions(data, &data[GIVENS_OFFSET], r2b);
+  if (variant.unitCount)
+    invalid |= validate_extra_units(data);
+  // a rejected lane is counted as rejected only, its filled in candidates never validate
+  invalid &= (uint16_t)~(deferred | failed);
+  stats->invalidLanes += _mm_popcnt_u32(invalid);
+  failed |= invalid;
+#endif
+  trace_end(TRACE_VERIFY, traceStart);
+
+  if (output) {
+    traceStart = trace_begin();
+    write_solutions(sudokus, stride, data, failed | deferred, output, outputStride);
+    trace_end(TRACE_WRITE, traceStart);
+  }
+  if (deferred) {
+    // a lane that could not be deferred keeps its solution of '0's
+    uint16_t dropped = defer_lanes(sudokus, solutions, stride, output, outputStride, deferred);
+    stats->invalidLanes += _mm_popcnt_u32(dropped);
+    failed |= dropped;
+  }
+
+  return failed;
 }
 
-static inline void transform_sudokus(const uint8_t *sudokus, uint16_t *data) {
+// returns a bit per lane holding a character other than '0'..'9'
+static inline uint16_t transform_sudokus(const uint8_t *sudokus, int stride, uint16_t *data) {
   int i;
   const uint8_t *p_src = sudokus;
   uint16_t *p_dest = data;
+  __m256i_u badLowVec = _mm256_setzero_si256(), badHighVec = _mm256_setzero_si256();
 
   // 5x16 = 80
   for (i = 0; i < 5; i++) {
     // solve 16x16
-    transpose8x16(p_src, p_dest);
-    transpose8x16(p_src + BYTES_FOR_8_SUDOKUS, p_dest + 8);
+    transpose8x16(p_src, stride, p_dest, &badLowVec);
+    transpose8x16(p_src + (stride << 3), stride, p_dest + 8, &badHighVec);
 
     p_src += 16;
     p_dest += (1 << 8);
   }
 
+  // both halves of a transposed vector hold the same 8 lanes
+  __m128i_u badLow = _mm_or_si128(_mm256_castsi256_si128(badLowVec), _mm256_extracti128_si256(badLowVec, 1));
+  __m128i_u badHigh = _mm_or_si128(_mm256_castsi256_si128(badHighVec), _mm256_extracti128_si256(badHighVec, 1));
+  uint16_t badChars = lane_mask(_mm256_set_m128i(badHigh, badLow));
+
   for (i = 0; i < 16; i++) {
-    *p_dest = (uint16_t)(0b100000000 >> ('9' - *p_src));
-    p_src += BYTES_FOR_1_SUDOKUS;
+    int bad = *p_src < '0' || *p_src > '9';
+    if (bad)
+      badChars |= (uint16_t)(1 << i);
+
+    // the shift is only defined for a digit, convert2base2 also leaves any other byte at 0
+    *p_dest = bad ? 0 : (uint16_t)(0b100000000 >> ('9' - *p_src));
+    p_src += stride;
     ++p_dest;
   }
+
+  return badChars;
 }
 
 // transpose 8 rows x 16 cols, with input in bytes and output in ushorts
-static inline void transpose8x16(const uint8_t *p_src, uint16_t *p_dest) {
+static inline void transpose8x16(const uint8_t *p_src, int stride, uint16_t *p_dest, __m256i_u *badCharVec) {
   __m256i_u v1, v2, v3, v4, v5, v6, v7, v8, lo12, lo34, lo56, lo78, hi12, hi34, hi56, hi78;
 
   v1 = _mm256_cvtepi8_epi16(_mm256_castsi256_si128(_mm256_loadu_si256((__m256i_u *)p_src)));
-  v2 = _mm256_cvtepi8_epi16(_mm256_castsi256_si128(_mm256_loadu_si256((__m256i_u *)(p_src + BYTES_FOR_1_SUDOKUS))));
-  v3 = _mm256_cvtepi8_epi16(_mm256_castsi256_si128(_mm256_loadu_si256((__m256i_u *)(p_src + BYTES_FOR_2_SUDOKUS))));
-  v4 = _mm256_cvtepi8_epi16(_mm256_castsi256_si128(_mm256_loadu_si256((__m256i_u *)(p_src + BYTES_FOR_3_SUDOKUS))));
-  v5 = _mm256_cvtepi8_epi16(_mm256_castsi256_si128(_mm256_loadu_si256((__m256i_u *)(p_src + BYTES_FOR_4_SUDOKUS))));
-  v6 = _mm256_cvtepi8_epi16(_mm256_castsi256_si128(_mm256_loadu_si256((__m256i_u *)(p_src + BYTES_FOR_5_SUDOKUS))));
-  v7 = _mm256_cvtepi8_epi16(_mm256_castsi256_si128(_mm256_loadu_si256((__m256i_u *)(p_src + BYTES_FOR_6_SUDOKUS))));
-  v8 = _mm256_cvtepi8_epi16(_mm256_castsi256_si128(_mm256_loadu_si256((__m256i_u *)(p_src + BYTES_FOR_7_SUDOKUS))));
+  v2 = _mm256_cvtepi8_epi16(_mm256_castsi256_si128(_mm256_loadu_si256((__m256i_u *)(p_src + stride * 1))));
+  v3 = _mm256_cvtepi8_epi16(_mm256_castsi256_si128(_mm256_loadu_si256((__m256i_u *)(p_src + stride * 2))));
+  v4 = _mm256_cvtepi8_epi16(_mm256_castsi256_si128(_mm256_loadu_si256((__m256i_u *)(p_src + stride * 3))));
+  v5 = _mm256_cvtepi8_epi16(_mm256_castsi256_si128(_mm256_loadu_si256((__m256i_u *)(p_src + stride * 4))));
+  v6 = _mm256_cvtepi8_epi16(_mm256_castsi256_si128(_mm256_loadu_si256((__m256i_u *)(p_src + stride * 5))));
+  v7 = _mm256_cvtepi8_epi16(_mm256_castsi256_si128(_mm256_loadu_si256((__m256i_u *)(p_src + stride * 6))));
+  v8 = _mm256_cvtepi8_epi16(_mm256_castsi256_si128(_mm256_loadu_si256((__m256i_u *)(p_src + stride * 7))));
 
   lo12 = _mm256_unpacklo_epi16(v1, v2);
   lo34 = _mm256_unpacklo_epi16(v3, v4);
@@ -201,7 +992,17 @@ static inline void transpose8x16(const uint8_t *p_src, uint16_t *p_dest) {
   v7 = lo78;
   v8 = hi78;
 
+  __m256i_u zeroCharVec = _mm256_set1_epi16('0');
   __m256i_u nineCharVec = _mm256_set1_epi16('9');
+  check_chars(&v1, &zeroCharVec, &nineCharVec, badCharVec);
+  check_chars(&v2, &zeroCharVec, &nineCharVec, badCharVec);
+  check_chars(&v3, &zeroCharVec, &nineCharVec, badCharVec);
+  check_chars(&v4, &zeroCharVec, &nineCharVec, badCharVec);
+  check_chars(&v5, &zeroCharVec, &nineCharVec, badCharVec);
+  check_chars(&v6, &zeroCharVec, &nineCharVec, badCharVec);
+  check_chars(&v7, &zeroCharVec, &nineCharVec, badCharVec);
+  check_chars(&v8, &zeroCharVec, &nineCharVec, badCharVec);
+
   __m256i_u oneVec = _mm256_set1_epi32(0b100000000);
   convert2base2(&v1, &nineCharVec, &oneVec);
   convert2base2(&v2, &nineCharVec, &oneVec);
@@ -212,22 +1013,27 @@ static inline void transpose8x16(const uint8_t *p_src, uint16_t *p_dest) {
   convert2base2(&v7, &nineCharVec, &oneVec);
   convert2base2(&v8, &nineCharVec, &oneVec);
 
-  _mm_storeu_si128((__m128i_u *)p_dest, _mm256_extracti128_si256(v1, 0));
-  _mm_storeu_si128((__m128i_u *)(p_dest + 0x10), _mm256_extracti128_si256(v2, 0));
-  _mm_storeu_si128((__m128i_u *)(p_dest + 0x20), _mm256_extracti128_si256(v3, 0));
-  _mm_storeu_si128((__m128i_u *)(p_dest + 0x30), _mm256_extracti128_si256(v4, 0));
-  _mm_storeu_si128((__m128i_u *)(p_dest + 0x40), _mm256_extracti128_si256(v5, 0));
-  _mm_storeu_si128((__m128i_u *)(p_dest + 0x50), _mm256_extracti128_si256(v6, 0));
-  _mm_storeu_si128((__m128i_u *)(p_dest + 0x60), _mm256_extracti128_si256(v7, 0));
-  _mm_storeu_si128((__m128i_u *)(p_dest + 0x70), _mm256_extracti128_si256(v8, 0));
-  _mm_storeu_si128((__m128i_u *)(p_dest + 0x80), _mm256_extracti128_si256(v1, 1));
-  _mm_storeu_si128((__m128i_u *)(p_dest + 0x90), _mm256_extracti128_si256(v2, 1));
-  _mm_storeu_si128((__m128i_u *)(p_dest + 0xA0), _mm256_extracti128_si256(v3, 1));
-  _mm_storeu_si128((__m128i_u *)(p_dest + 0xB0), _mm256_extracti128_si256(v4, 1));
-  _mm_storeu_si128((__m128i_u *)(p_dest + 0xC0), _mm256_extracti128_si256(v5, 1));
-  _mm_storeu_si128((__m128i_u *)(p_dest + 0xD0), _mm256_extracti128_si256(v6, 1));
-  _mm_storeu_si128((__m128i_u *)(p_dest + 0xE0), _mm256_extracti128_si256(v7, 1));
-  _mm_storeu_si128((__m128i_u *)(p_dest + 0xF0), _mm256_extracti128_si256(v8, 1));
+  _mm_store_si128((__m128i *)p_dest, _mm256_extracti128_si256(v1, 0));
+  _mm_store_si128((__m128i *)(p_dest + 0x10), _mm256_extracti128_si256(v2, 0));
+  _mm_store_si128((__m128i *)(p_dest + 0x20), _mm256_extracti128_si256(v3, 0));
+  _mm_store_si128((__m128i *)(p_dest + 0x30), _mm256_extracti128_si256(v4, 0));
+  _mm_store_si128((__m128i *)(p_dest + 0x40), _mm256_extracti128_si256(v5, 0));
+  _mm_store_si128((__m128i *)(p_dest + 0x50), _mm256_extracti128_si256(v6, 0));
+  _mm_store_si128((__m128i *)(p_dest + 0x60), _mm256_extracti128_si256(v7, 0));
+  _mm_store_si128((__m128i *)(p_dest + 0x70), _mm256_extracti128_si256(v8, 0));
+  _mm_store_si128((__m128i *)(p_dest + 0x80), _mm256_extracti128_si256(v1, 1));
+  _mm_store_si128((__m128i *)(p_dest + 0x90), _mm256_extracti128_si256(v2, 1));
+  _mm_store_si128((__m128i *)(p_dest + 0xA0), _mm256_extracti128_si256(v3, 1));
+  _mm_store_si128((__m128i *)(p_dest + 0xB0), _mm256_extracti128_si256(v4, 1));
+  _mm_store_si128((__m128i *)(p_dest + 0xC0), _mm256_extracti128_si256(v5, 1));
+  _mm_store_si128((__m128i *)(p_dest + 0xD0), _mm256_extracti128_si256(v6, 1));
+  _mm_store_si128((__m128i *)(p_dest + 0xE0), _mm256_extracti128_si256(v7, 1));
+  _mm_store_si128((__m128i *)(p_dest + 0xF0), _mm256_extracti128_si256(v8, 1));
+}
+static inline void check_chars(__m256i_u *charVec, __m256i_u *zeroCharVec, __m256i_u *nineCharVec,
+                               __m256i_u *badCharVec) {
+  *badCharVec = _mm256_or_si256(*badCharVec, _mm256_cmpgt_epi16(*charVec, *nineCharVec));
+  *badCharVec = _mm256_or_si256(*badCharVec, _mm256_cmpgt_epi16(*zeroCharVec, *charVec));
 }
 static inline void convert2base2(__m256i_u *cellVec, __m256i_u *nineCharVec, __m256i_u *nineBitVec) {
   __m256i_u cellsInBase10 = _mm256_sub_epi16(*nineCharVec, *cellVec);
@@ -243,83 +1049,100 @@ static inline void convert2base2(__m256i_u *cellVec, __m256i_u *nineCharVec, __m
   *cellVec = cellsInBase2;
 }
 
-static inline void setup_step(uint16_t *data, int *r2b) {
+// returns a bit per lane where two givens share a digit in a row, box or column
+static inline uint16_t setup_step(uint16_t *data, int *r2b) {
   uint16_t *p_rows = &data[ROW_OFFSET], *p_boxs = &data[BOX_OFFSET], *p_cols = &data[COL_OFFSET];
   int i, rowMaxI = 9 << 4;
 
   __m256i_u maskVec = _mm256_set1_epi16((short)0b111111111);
   for (i = 0; i < rowMaxI; i += 16) {
-    _mm256_storeu_si256((__m256i_u *)(p_rows + i), maskVec);
-    _mm256_storeu_si256((__m256i_u *)(p_boxs + i), maskVec);
-    _mm256_storeu_si256((__m256i_u *)(p_cols + i), maskVec);
+    store_cells(p_rows + i, maskVec);
+    store_cells(p_boxs + i, maskVec);
+    store_cells(p_cols + i, maskVec);
   }
 
   int p = 0, r = 0, b, c, maxB, maxC;
   __m256i_u *p_r, *p_b, *p_c;
+  __m256i_u conflictVec = _mm256_setzero_si256();
   for (; r < 9; r++) {
     p_r = (__m256i_u *)&p_rows[r << 4];
-    __m256i_u rVec = _mm256_loadu_si256(p_r);
+    __m256i_u rVec = load_cells(p_r);
 
     b = r2b[r];
     c = 0;
     maxB = b + 3;
     for (; b < maxB; b++) {
       p_b = (__m256i_u *)&p_boxs[b << 4];
-      __m256i_u bVec = _mm256_loadu_si256(p_b);
+      __m256i_u bVec = load_cells(p_b);
 
       maxC = c + 3;
       for (; c < maxC; c++, p++) {
         p_c = (__m256i_u *)&p_cols[c << 4];
-        __m256i cVec = _mm256_loadu_si256(p_c);
-        __m256i pVec = _mm256_loadu_si256((__m256i_u *)&data[p << 4]);
+        __m256i cVec = load_cells(p_c);
+        __m256i pVec = load_cells(&data[p << 4]);
+
+        // a digit that is no longer remaining was already given in one of the units
+        __m256i_u remainVec = _mm256_and_si256(rVec, _mm256_and_si256(bVec, cVec));
+        conflictVec = _mm256_or_si256(conflictVec, _mm256_andnot_si256(remainVec, pVec));
 
         rVec = _mm256_andnot_si256(pVec, rVec);
         bVec = _mm256_andnot_si256(pVec, bVec);
         cVec = _mm256_andnot_si256(pVec, cVec);
-        _mm256_storeu_si256(p_c, cVec);
+        store_cells(p_c, cVec);
       }
 
-      _mm256_storeu_si256(p_b, bVec);
+      store_cells(p_b, bVec);
     }
-    _mm256_storeu_si256(p_r, rVec);
+    store_cells(p_r, rVec);
   }
+
+  return (uint16_t)~lane_mask(_mm256_cmpeq_epi16(conflictVec, _mm256_setzero_si256()));
 }
 
-typedef struct {
-  __m256i_u *p_r, *p_b, *p_c, *p_p;
-} cell_t;
+// fills every cell of the rejected lanes with all candidates, so the sweeps and the queue treat them as done
+static void reject_lanes(uint16_t *data, uint16_t mask) {
+  __m256i_u rejectVec = _mm256_and_si256(lane_vec(mask), _mm256_set1_epi16((short)0b111111111));
 
-static inline void solve_parallel(uint16_t *data, int *r2b) {
+  int maxI = SUDOKU_CELL_COUNT << 4;
+  for (int i = 0; i < maxI; i += 16) {
+    __m256i_u pVec = load_cells(&data[i]);
+    store_cells(&data[i], _mm256_or_si256(pVec, rejectVec));
+  }
+}
+
+// returns a bit per lane whose fallback search ran out of budget
+static inline uint16_t solve_parallel(uint16_t *data, int *r2b, solver_stats_t *stats) {
   uint16_t *p_rows = &data[ROW_OFFSET], *p_boxs = &data[BOX_OFFSET], *p_cols = &data[COL_OFFSET];
 
-  int qLen = SUDOKU_CELL_COUNT << 1, qEnd = 0;
-  cell_t queue[qLen];
+  int qEnd = 0;
+  cell_t queue[TUNE_MAX_QUEUE_LENGTH];
 
   int i, p, r, b, c, maxB, maxC;
   __m256i_u *p_r, *p_b, *p_c, *p_p;
   __m256i_u zeroVec = _mm256_setzero_si256();
   __m256i_u oneVec = _mm256_set1_epi16((short)1);
+  uint64_t traceStart = trace_begin();
 
-  i = 2;
+  i = tuner.sweeps - 1;
   do {
     for (p = 0, r = 0; r < 9; r++) {
       p_r = (__m256i_u *)&p_rows[r << 4];
-      __m256i_u rVec = _mm256_loadu_si256(p_r);
+      __m256i_u rVec = load_cells(p_r);
 
       for (b = r2b[r], maxB = b + 3, c = 0; b < maxB; b++) {
         p_b = (__m256i_u *)&p_boxs[b << 4];
-        __m256i_u bVec = _mm256_loadu_si256(p_b);
+        __m256i_u bVec = load_cells(p_b);
 
         for (maxC = c + 3; c < maxC; c++, p++) {
           p_c = (__m256i_u *)&p_cols[c << 4];
           p_p = (__m256i_u *)&data[p << 4];
-          __m256i_u cVec = _mm256_loadu_si256(p_c);
-          __m256i_u pVec = _mm256_loadu_si256(p_p);
+          __m256i_u cVec = load_cells(p_c);
+          __m256i_u pVec = load_cells(p_p);
 
           solve_cell(&pVec, &rVec, &bVec, &cVec, &zeroVec, &oneVec);
 
-          _mm256_storeu_si256(p_p, pVec);
-          _mm256_storeu_si256(p_c, cVec);
+          store_cells(p_p, pVec);
+          store_cells(p_c, cVec);
 
           if (i == 0 && (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi16(pVec, zeroVec)) > 0) {
             cell_t cell = (cell_t){p_r, p_b, p_c, p_p};
@@ -327,54 +1150,116 @@ static inline void solve_parallel(uint16_t *data, int *r2b) {
           }
         }
 
-        _mm256_storeu_si256(p_b, bVec);
+        store_cells(p_b, bVec);
+      }
+      store_cells(p_r, rVec);
+    }
+  } while (i-- != 0);
+  stats->fullSweeps += tuner.sweeps;
+  trace_end(TRACE_SWEEPS, traceStart);
+
+  return run_queue(queue, qEnd, data, r2b, stats);
+}
+
+// same sweeps as solve_parallel, but every cell is solved in all blocks before moving on
+static inline void solve_parallel_interleaved(uint16_t **blocks, int *r2b, uint16_t *deferred, solver_stats_t *stats) {
+  int qEnd[INTERLEAVED_BLOCKS] = {0};
+  cell_t queue[INTERLEAVED_BLOCKS][TUNE_MAX_QUEUE_LENGTH];
+
+  int i, k, p, r, b, c, maxB, maxC;
+  __m256i_u *p_r[INTERLEAVED_BLOCKS], *p_b[INTERLEAVED_BLOCKS];
+  __m256i_u rVec[INTERLEAVED_BLOCKS], bVec[INTERLEAVED_BLOCKS];
+  __m256i_u zeroVec = _mm256_setzero_si256();
+  __m256i_u oneVec = _mm256_set1_epi16((short)1);
+  uint64_t traceStart = trace_begin();
+
+  i = tuner.sweeps - 1;
+  do {
+    for (p = 0, r = 0; r < 9; r++) {
+      for (k = 0; k < INTERLEAVED_BLOCKS; k++) {
+        p_r[k] = (__m256i_u *)&blocks[k][ROW_OFFSET + (r << 4)];
+        rVec[k] = load_cells(p_r[k]);
+      }
+
+      for (b = r2b[r], maxB = b + 3, c = 0; b < maxB; b++) {
+        for (k = 0; k < INTERLEAVED_BLOCKS; k++) {
+          p_b[k] = (__m256i_u *)&blocks[k][BOX_OFFSET + (b << 4)];
+          bVec[k] = load_cells(p_b[k]);
+        }
+
+        for (maxC = c + 3; c < maxC; c++, p++) {
+          for (k = 0; k < INTERLEAVED_BLOCKS; k++) {
+            __m256i_u *p_c = (__m256i_u *)&blocks[k][COL_OFFSET + (c << 4)];
+            __m256i_u *p_p = (__m256i_u *)&blocks[k][p << 4];
+            __m256i_u cVec = load_cells(p_c);
+            __m256i_u pVec = load_cells(p_p);
+
+            solve_cell(&pVec, &rVec[k], &bVec[k], &cVec, &zeroVec, &oneVec);
+
+            store_cells(p_p, pVec);
+            store_cells(p_c, cVec);
+
+            if (i == 0 && (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi16(pVec, zeroVec)) > 0) {
+              queue[k][qEnd[k]++] = (cell_t){p_r[k], p_b[k], p_c, p_p};
+            }
+          }
+        }
+
+        for (k = 0; k < INTERLEAVED_BLOCKS; k++)
+          store_cells(p_b[k], bVec[k]);
       }
-      _mm256_storeu_si256(p_r, rVec);
+      for (k = 0; k < INTERLEAVED_BLOCKS; k++)
+        store_cells(p_r[k], rVec[k]);
     }
   } while (i-- != 0);
+  stats->fullSweeps += tuner.sweeps * INTERLEAVED_BLOCKS;
+  trace_end(TRACE_SWEEPS, traceStart);
+
+  for (k = 0; k < INTERLEAVED_BLOCKS; k++)
+    deferred[k] = run_queue(queue[k], qEnd[k], blocks[k], r2b, stats);
+}
+
+// solves the queued cells until they are all solved, or routes the block to the fallbacks when the queue overflows.
+// Returns the lanes the fallbacks deferred.
+static inline uint16_t run_queue(cell_t *queue, int qEnd, uint16_t *data, int *r2b, solver_stats_t *stats) {
+  int qLen = tuner.queueLength;
+  __m256i_u zeroVec = _mm256_setzero_si256();
+  __m256i_u oneVec = _mm256_set1_epi16((short)1);
+  uint64_t traceStart = trace_begin();
 
-  int qIdx = 0;
+  // the last queue entry that solved a cell in some lane
+  int qIdx = 0, lastProgress = 0;
   while (qIdx < qEnd && qEnd < qLen) {
     cell_t cell = queue[qIdx];
 
-    __m256i_u rVec = _mm256_loadu_si256(cell.p_r);
-    __m256i_u bVec = _mm256_loadu_si256(cell.p_b);
-    __m256i_u cVec = _mm256_loadu_si256(cell.p_c);
-    __m256i_u pVec = _mm256_loadu_si256(cell.p_p);
+    __m256i_u rVec = load_cells(cell.p_r);
+    __m256i_u bVec = load_cells(cell.p_b);
+    __m256i_u cVec = load_cells(cell.p_c);
+    __m256i_u pVec = load_cells(cell.p_p);
+    __m256i_u solvedVec = pVec;
 
     solve_cell(&pVec, &rVec, &bVec, &cVec, &zeroVec, &oneVec);
+    lastProgress = _mm256_testc_si256(solvedVec, pVec) ? lastProgress : qIdx;
 
-    _mm256_storeu_si256(cell.p_p, pVec);
-    _mm256_storeu_si256(cell.p_c, cVec);
-    _mm256_storeu_si256(cell.p_b, bVec);
-    _mm256_storeu_si256(cell.p_r, rVec);
+    store_cells(cell.p_p, pVec);
+    store_cells(cell.p_c, cVec);
+    store_cells(cell.p_b, bVec);
+    store_cells(cell.p_r, rVec);
 
     if ((uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi16(pVec, zeroVec)) > 0) {
       queue[qEnd++] = cell;
     }
     ++qIdx;
   }
-  queueLengthTotal += qIdx;
+  stats->queueIterations += qIdx;
+  trace_end(TRACE_QUEUE, traceStart);
+  tune_queue_run(qIdx, lastProgress, qEnd == qLen, stats);
 
   if (qEnd == qLen) {
-    for (; qIdx < qLen; qIdx++) {
-      cell_t cell = queue[qIdx];
-      __m256i_u rVec = _mm256_loadu_si256(cell.p_r);
-      __m256i_u bVec = _mm256_loadu_si256(cell.p_b);
-      __m256i_u cVec = _mm256_loadu_si256(cell.p_c);
-      __m256i_u pVec = _mm256_loadu_si256(cell.p_p);
-
-      uint32_t mask = (uint32_t)_mm256_movemask_epi8(_mm256_cmpgt_epi16(rVec, zeroVec));
-      if (mask > 0) {
-        for (i = 0; i != 16; ++i) {
-          if ((mask & 1) == 1)
-            solve_single_puzzle(data, r2b, i);
-
-          mask >>= 2;
-        }
-      }
-    }
+    ++stats->overflowBlocks;
+    return route_unsolved_lanes(data, r2b, stats);
   }
+  return 0;
 }
 
 static inline void solve_cell(__m256i_u *pVec, __m256i_u *rVec, __m256i_u *bVec, __m256i_u *cVec, __m256i_u *zeroVec,
@@ -392,7 +1277,7 @@ static inline void solve_cell(__m256i_u *pVec, __m256i_u *rVec, __m256i_u *bVec,
   *cVec = _mm256_andnot_si256(bits, *cVec);
 }
 
-static char solve_single_puzzle(uint16_t *data, int *r2b, int puzzleOffset) {
+static char solve_single_puzzle(uint16_t *data, int *r2b, int puzzleOffset, solver_stats_t *stats, int depth) {
   uint16_t *p_puzzles = &data[puzzleOffset], *p_rows = &data[ROW_OFFSET + puzzleOffset],
            *p_boxs = &data[BOX_OFFSET + puzzleOffset], *p_cols = &data[COL_OFFSET + puzzleOffset];
 
@@ -439,8 +1324,13 @@ static char solve_single_puzzle(uint16_t *data, int *r2b, int puzzleOffset) {
         uint32_t bits = (uint32_t)(row & col & box);
         uint32_t bitCount = _mm_popcnt_u32(bits);
         if (bitCount == 2) {
+          if (!spend_budget_node())
+            return 0;
+
           uint16_t dataCopy[DATA_LENGTH];
           memcpy(dataCopy, data, DATA_LENGTH * sizeof(uint16_t));
+          stats->backtrackBytes += DATA_LENGTH * sizeof(uint16_t);
+          ++stats->guessDepth[depth < STATS_GUESS_DEPTH_COUNT ? depth : STATS_GUESS_DEPTH_COUNT - 1];
 
           uint32_t bit2 = _blsr_u32(bits);
           uint32_t bit1 = bits ^ bit2;
@@ -450,17 +1340,18 @@ static char solve_single_puzzle(uint16_t *data, int *r2b, int puzzleOffset) {
           p_boxs[b << 4] = (uint16_t)(box & ~bit1);
           p_cols[c << 4] = (uint16_t)(col & ~bit1);
 
-          if (solve_single_puzzle(data, r2b, puzzleOffset))
+          if (solve_single_puzzle(data, r2b, puzzleOffset, stats, depth + 1))
             return 1;
 
           memcpy(data, dataCopy, DATA_LENGTH * sizeof(uint16_t));
+          stats->backtrackBytes += DATA_LENGTH * sizeof(uint16_t);
 
           p_puzzles[p << 4] = (uint16_t)bit2;
           p_rows[r << 4] = (uint16_t)(row & ~bit2);
           p_boxs[b << 4] = (uint16_t)(box & ~bit2);
           p_cols[c << 4] = (uint16_t)(col & ~bit2);
 
-          return solve_single_puzzle(data, r2b, puzzleOffset);
+          return solve_single_puzzle(data, r2b, puzzleOffset, stats, depth + 1);
         }
       }
     }
@@ -469,90 +1360,3091 @@ static char solve_single_puzzle(uint16_t *data, int *r2b, int puzzleOffset) {
   return 1;
 }
 
-static inline void check_solutions(uint16_t *data, uint16_t *solutions) {
-  int maxI = SUDOKU_CELL_COUNT << 4;
-  for (int i = 0; i < maxI; i += 16) {
-    __m256i_u pVec = _mm256_loadu_si256((__m256i_u *)&data[i]);
-    __m256i_u sVec = _mm256_loadu_si256((__m256i_u *)&solutions[i]);
-    __m256i_u mask = _mm256_cmpeq_epi16(pVec, sVec);
+#pragma region variants
+// Parses a comma separated list of x (both diagonals), windoku (the four windows at rows and columns 1-3 and 5-7) and
+// disjoint (the cells at the same position of every box). Returns 0 for an unknown or repeated name, or for more units
+// than MAX_EXTRA_UNITS, or MAX_CELL_EXTRA_UNITS on a cell.
+static int init_variant(const char *spec) {
+  static const char *names[] = {"x", "windoku", "disjoint"};
+  int cells[9], i, j, seen = 0, name;
+  memset(&variant, 0, sizeof(variant));
 
-    if (_mm256_movemask_epi8(mask) != 0xFFFFFFFF) {
-      ++failedCount;
-      break;
+  while (*spec) {
+    size_t length = strcspn(spec, ",");
+    for (name = 0; name < 3 && (strlen(names[name]) != length || strncmp(spec, names[name], length)); name++)
+      ;
+    if (name == 3 || seen >> name & 1)
+      return 0;
+    seen |= 1 << name;
+
+    if (name == 0) {
+      for (i = 0; i < 9; i++)
+        cells[i] = i * 9 + i;
+      if (!add_extra_unit(cells))
+        return 0;
+      for (i = 0; i < 9; i++)
+        cells[i] = i * 9 + 8 - i;
+      if (!add_extra_unit(cells))
+        return 0;
+    } else if (name == 1) {
+      for (int w = 0; w < 4; w++) {
+        for (i = 0; i < 9; i++)
+          cells[i] = (1 + (w >> 1) * 4 + i / 3) * 9 + 1 + (w & 1) * 4 + i % 3;
+        if (!add_extra_unit(cells))
+          return 0;
+      }
+    } else {
+      for (j = 0; j < 9; j++) {
+        for (i = 0; i < 9; i++)
+          cells[i] = (i / 3 * 3 + j / 3) * 9 + i % 3 * 3 + j % 3;
+        if (!add_extra_unit(cells))
+          return 0;
+      }
     }
+    spec += length + (spec[length] == ',');
   }
+  return 1;
 }
 
-#pragma region tests
-static inline void test_transform_sudokus(const uint8_t *sudokus, uint16_t *data) {
-  int i, j, sOffset;
-  int testData[SUDOKU_CELL_COUNT << 4];
+// returns 0 when the unit does not fit the limits of the data layout and the exact cover columns
+static int add_extra_unit(const int *cells) {
+  int i;
+  if (variant.unitCount == MAX_EXTRA_UNITS)
+    return 0;
+  for (i = 0; i < 9; i++) {
+    if (variant.cellUnitCount[cells[i]] == MAX_CELL_EXTRA_UNITS)
+      return 0;
+  }
 
-  for (i = 0; i < 16; i++) {
-    sOffset = i * BYTES_FOR_1_SUDOKUS;
-    for (j = 0; j < SUDOKU_CELL_COUNT; j++) {
-      testData[(j << 4) + i] = (uint16_t)(0b100000000 >> ('9' - sudokus[sOffset + j]));
-    }
+  int u = variant.unitCount++;
+  for (i = 0; i < 9; i++) {
+    variant.unitCells[u][i] = (uint8_t)cells[i];
+    variant.cellUnits[cells[i]][variant.cellUnitCount[cells[i]]++] = (uint8_t)u;
   }
+  return 1;
+}
 
-  for (i = 0; i < SUDOKU_CELL_COUNT << 4; i++) {
-    if (data[i] != testData[i]) {
-      printf("transform fail: %d <> %d (i=%d)", data[i], testData[i], i);
-      exit(1);
+// like setup_step for the extra units, returns a bit per lane that gives a digit twice in one of them
+static uint16_t setup_extra_units(uint16_t *data) {
+  __m256i_u maskVec = _mm256_set1_epi16((short)0b111111111);
+  __m256i_u conflictVec = _mm256_setzero_si256();
+
+  for (int u = 0; u < variant.unitCount; u++) {
+    __m256i_u uVec = maskVec;
+    for (int i = 0; i < 9; i++) {
+      __m256i_u pVec = load_cells(&data[variant.unitCells[u][i] << 4]);
+      conflictVec = _mm256_or_si256(conflictVec, _mm256_andnot_si256(uVec, pVec));
+      uVec = _mm256_andnot_si256(pVec, uVec);
     }
+    store_cells(&data[EXTRA_OFFSET + (u << 4)], uVec);
   }
+
+  return (uint16_t)~lane_mask(_mm256_cmpeq_epi16(conflictVec, _mm256_setzero_si256()));
 }
-static void test_setup_step(uint16_t *data) {
-  int len = DATA_LENGTH - ROW_OFFSET;
-  uint16_t dataArr[len];
-  for (int i = 0; i < len; i++) {
-    dataArr[i] = data[i + ROW_OFFSET];
-  }
 
-  uint16_t testData[len];
-  for (int i = 0; i < len; i++) {
-    testData[i] = 0b111111111;
-  }
+// The extra units have no place in the r2b walk, so variants sweep every cell with its row, box, column and extra
+// units until a sweep changes nothing, and the lanes that are still open go to the fallbacks. Returns the deferred
+// lanes like solve_parallel.
+static uint16_t solve_parallel_variant(uint16_t *data, int *r2b, solver_stats_t *stats) {
+  __m256i_u zeroVec = _mm256_setzero_si256(), oneVec = _mm256_set1_epi16((short)1);
+  __m256i_u changedVec, openVec;
+  uint64_t traceStart = trace_begin();
+  int i, p;
 
-  uint16_t *p_rows = &testData[0], *p_boxs = &testData[9 << 4], *p_cols = &testData[(9 << 4) * 2];
-  for (int i = 0; i < 16; i++) {
-    for (int p = 0; p < 81; p++) {
-      int r = p / 9;
-      int c = p % 9;
-      int b = r / 3 * 3 + c / 3;
+  do {
+    changedVec = openVec = zeroVec;
 
-      uint16_t mask = ~data[(p << 4) + i];
-      p_rows[(r << 4) + i] &= mask;
-      p_boxs[(b << 4) + i] &= mask;
-      p_cols[(c << 4) + i] &= mask;
+    for (p = 0; p < SUDOKU_CELL_COUNT; p++) {
+      int r = p / 9, c = p % 9, b = r2b[r] + c / 3, unitCount = variant.cellUnitCount[p];
+      __m256i_u *p_r = (__m256i_u *)&data[ROW_OFFSET + (r << 4)], *p_b = (__m256i_u *)&data[BOX_OFFSET + (b << 4)];
+      __m256i_u *p_c = (__m256i_u *)&data[COL_OFFSET + (c << 4)], *p_p = (__m256i_u *)&data[p << 4];
+      __m256i_u pVec = load_cells(p_p);
+
+      __m256i_u bits = _mm256_and_si256(_mm256_and_si256(load_cells(p_r), load_cells(p_b)), load_cells(p_c));
+      for (i = 0; i < unitCount; i++)
+        bits = _mm256_and_si256(bits, load_cells(&data[EXTRA_OFFSET + (variant.cellUnits[p][i] << 4)]));
+      bits = _mm256_or_si256(bits, pVec);
+
+      __m256i_u mask = _mm256_cmpeq_epi16(_mm256_and_si256(bits, _mm256_sub_epi16(bits, oneVec)), zeroVec);
+      bits = _mm256_and_si256(mask, bits);
+      changedVec = _mm256_or_si256(changedVec, _mm256_andnot_si256(pVec, bits));
+      pVec = _mm256_or_si256(bits, pVec);
+      openVec = _mm256_or_si256(openVec, _mm256_cmpeq_epi16(pVec, zeroVec));
+
+      store_cells(p_p, pVec);
+      store_cells(p_r, _mm256_andnot_si256(bits, load_cells(p_r)));
+      store_cells(p_b, _mm256_andnot_si256(bits, load_cells(p_b)));
+      store_cells(p_c, _mm256_andnot_si256(bits, load_cells(p_c)));
+      for (i = 0; i < unitCount; i++) {
+        uint16_t *p_u = &data[EXTRA_OFFSET + (variant.cellUnits[p][i] << 4)];
+        store_cells(p_u, _mm256_andnot_si256(bits, load_cells(p_u)));
+      }
     }
-  }
+    ++stats->fullSweeps;
+  } while (!_mm256_testz_si256(changedVec, changedVec) && !_mm256_testz_si256(openVec, openVec));
+  trace_end(TRACE_SWEEPS, traceStart);
 
-  for (int i = 0; i < len; i++) {
-    if (dataArr[i] != testData[i]) {
-      printf("SetupStep fail: %d <> %d", dataArr[i], testData[i]);
-      exit(1);
+  // there is no queue to overflow, lanes still open simply need the fallbacks
+  if (_mm256_testz_si256(openVec, openVec))
+    return 0;
+  return route_unsolved_lanes(data, r2b, stats);
+}
+
+// returns a bit per lane where an extra unit does not hold every digit exactly once
+static uint16_t validate_extra_units(const uint16_t *data) {
+  __m256i_u maskVec = _mm256_set1_epi16((short)0b111111111);
+  __m256i_u badVec = _mm256_setzero_si256();
+
+  for (int u = 0; u < variant.unitCount; u++) {
+    __m256i_u uVec = _mm256_setzero_si256();
+    for (int i = 0; i < 9; i++) {
+      __m256i_u pVec = load_cells(&data[variant.unitCells[u][i] << 4]);
+      badVec = _mm256_or_si256(badVec, _mm256_and_si256(uVec, pVec));
+      uVec = _mm256_or_si256(uVec, pVec);
     }
+    badVec = _mm256_or_si256(badVec, _mm256_xor_si256(uVec, maskVec));
   }
+
+  return (uint16_t)~lane_mask(_mm256_cmpeq_epi16(badVec, _mm256_setzero_si256()));
 }
 
+// the candidates the extra units of cell p leave in a lane, all digits for a classic puzzle
+static inline uint16_t extra_candidates(const uint16_t *p_extras, int p) {
+  uint16_t bits = 0b111111111;
+  for (int i = 0; i < variant.cellUnitCount[p]; i++)
+    bits &= p_extras[variant.cellUnits[p][i] << 4];
+  return bits;
+}
 #pragma endregion
 
-#pragma region debug
+#pragma region library
+// The caller's puzzles are transformed in place and the solutions untransformed straight into out. A block reads 15
+// bytes past its last record, so the last 1..16 puzzles are copied into a padded block instead, or solved a puzzle at a
+// time when there are only a few of them.
+int64_t solve_batch(const uint8_t *in, uint8_t *out, size_t n, uint32_t flags) {
+  uint8_t tail[16 * SUDOKU_CELL_COUNT + INPUT_PADDING], tailOutput[16 * SUDOKU_CELL_COUNT];
+  solver_stats_t stats = {0};
+  int threadCount = (int)SOLVE_BATCH_THREADS(flags);
+  size_t direct = n ? (n - 1) & ~(size_t)15 : 0, i;
+  int64_t failed = 0;
+  if (!in || !out)
+    return -1;
 
-static void print_sudoku(uint16_t *data, int puzzleOffset) {
-  int bit2num[1 << 9];
-  bit2num[0] = 0;
-  int num = 1, bit = 1;
+#ifndef _WIN32
+  if (!threadCount)
+    threadCount = (int)sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+  threadCount = threadCount < 1 ? 1 : threadCount;
 
-  while (num <= 9) {
-    bit2num[bit] = num;
-    bit <<= 1;
-    ++num;
+  batch_t batch = {0};
+  batch.stride = batch.outputStride = SUDOKU_CELL_COUNT;
+  for (i = 0; i < direct; i += LIBRARY_BATCH_LENGTH) {
+    batch.sudokus = &in[i * SUDOKU_CELL_COUNT];
+    batch.output = &out[i * SUDOKU_CELL_COUNT];
+    batch.count = (int)(direct - i < LIBRARY_BATCH_LENGTH ? direct - i : LIBRARY_BATCH_LENGTH);
+    run_library_batch(&batch, threadCount, &stats);
   }
 
-  for (int i = 0; i < SUDOKU_CELL_COUNT; i++) {
-    if (i > 0) {
+  if (n > direct && n - direct <= CROSS_CELL_MAX_LANES && !variant.unitCount) {
+    solve_cross_cell_lanes(&in[direct * SUDOKU_CELL_COUNT], NULL, SUDOKU_CELL_COUNT, (int)(n - direct),
+                           &out[direct * SUDOKU_CELL_COUNT], SUDOKU_CELL_COUNT, &stats);
+  } else if (n > direct) {
+    memcpy(tail, &in[direct * SUDOKU_CELL_COUNT], (n - direct) * SUDOKU_CELL_COUNT);
+    pad_batch(tail, NULL, (int)(n - direct), SUDOKU_CELL_COUNT, 0);
+    batch.sudokus = tail;
+    batch.output = tailOutput;
+    batch.count = 16;
+    run_library_batch(&batch, 1, &stats);
+    memcpy(&out[direct * SUDOKU_CELL_COUNT], tailOutput, (n - direct) * SUDOKU_CELL_COUNT);
+  }
+
+  // a solved puzzle never starts with a '0'
+  for (i = 0; i < n; i++)
+    failed += out[i * SUDOKU_CELL_COUNT] == '0';
+  return failed;
+}
+
+// the workers of run_threaded are shared, so threaded calls from several caller threads take turns
+static void run_library_batch(const batch_t *batch, int threadCount, solver_stats_t *stats) {
+  static pthread_mutex_t threadedLock = PTHREAD_MUTEX_INITIALIZER;
+
+  if (threadCount == 1 || batch->count <= 16 * INTERLEAVED_BLOCKS) {
+    uint16_t *arena = alloc_block_arena(INTERLEAVED_BLOCKS, -1);
+    run(batch, arena, stats);
+    free_block_arena(arena, INTERLEAVED_BLOCKS, -1);
+  } else {
+    pthread_mutex_lock(&threadedLock);
+    run_threaded(batch, threadCount, 0, stats);
+    pthread_mutex_unlock(&threadedLock);
+  }
+}
+
+// Blocks of 16 boards go through transform_sudokus and setup_step like a batch to solve, and hint_block takes the
+// candidates from there instead of the sweeps. The last 1..16 boards are copied into a padded block, like in
+// solve_batch.
+int64_t hint_batch(const uint8_t *in, uint16_t *candidates, sudoku_hint_t *hints, size_t n, uint32_t flags) {
+  uint8_t tail[16 * SUDOKU_CELL_COUNT + INPUT_PADDING];
+  size_t direct = n ? (n - 1) & ~(size_t)15 : 0, i;
+  int64_t invalid = 0;
+  (void)flags;
+  if (!in || !hints)
+    return -1;
+
+  uint16_t *data = alloc_block_arena(1, -1);
+  for (i = 0; i < direct; i += 16)
+    invalid += _mm_popcnt_u32(hint_block(&in[i * SUDOKU_CELL_COUNT], 16,
+                                         candidates ? &candidates[i * SUDOKU_CELL_COUNT] : NULL, &hints[i], data));
+
+  if (n > direct) {
+    memcpy(tail, &in[direct * SUDOKU_CELL_COUNT], (n - direct) * SUDOKU_CELL_COUNT);
+    pad_batch(tail, NULL, (int)(n - direct), SUDOKU_CELL_COUNT, 0);
+    invalid += _mm_popcnt_u32(hint_block(tail, (int)(n - direct),
+                                         candidates ? &candidates[direct * SUDOKU_CELL_COUNT] : NULL, &hints[direct],
+                                         data));
+  }
+  free_block_arena(data, 1, -1);
+  return invalid;
+}
+
+// Candidates and hints of the first count boards of a block, returns the invalid lanes among them. An open cell gets
+// the digits its row, box and column have left. The first open cell with a single candidate is a naked single, else
+// the first unit where a digit fits a single open cell holds a hidden single. An open cell without candidates, or a
+// unit with a digit left and no open cell for it, makes a board invalid.
+static uint16_t hint_block(const uint8_t *sudokus, int count, uint16_t *candidates, sudoku_hint_t *hints,
+                           uint16_t *data) {
+  static int r2b[9] = {0, 0, 0, 3, 3, 3, 6, 6, 6};
+  uint16_t *p_rows = &data[ROW_OFFSET], *p_boxs = &data[BOX_OFFSET], *p_cols = &data[COL_OFFSET];
+  uint16_t *givens = &data[GIVENS_OFFSET];
+  __m256i zeroVec = _mm256_setzero_si256(), oneVec = _mm256_set1_epi16(1), allVec = _mm256_cmpeq_epi16(zeroVec, zeroVec);
+  __m256i deadVec = zeroVec, foundVec = zeroVec, hiddenVec = zeroVec;
+  __m256i cellVec = zeroVec, digitVec = zeroVec, unitVec = zeroVec;
+  int p, u, k;
+
+  uint16_t invalid = transform_sudokus(sudokus, SUDOKU_CELL_COUNT, data);
+  memcpy(givens, data, (SUDOKU_CELL_COUNT << 4) * sizeof(uint16_t));
+  invalid |= setup_step(data, r2b);
+
+  for (p = 0; p < SUDOKU_CELL_COUNT; p++) {
+    int r = p / 9, c = p % 9;
+    __m256i openVec = _mm256_cmpeq_epi16(load_cells(&givens[p << 4]), zeroVec);
+    __m256i candVec = _mm256_and_si256(load_cells(&p_rows[r << 4]), load_cells(&p_cols[c << 4]));
+    candVec = _mm256_and_si256(candVec, load_cells(&p_boxs[(r2b[r] + c / 3) << 4]));
+    store_cells(&data[p << 4], _mm256_blendv_epi8(load_cells(&data[p << 4]), candVec, openVec));
+
+    __m256i noneVec = _mm256_cmpeq_epi16(candVec, zeroVec);
+    __m256i singleVec = _mm256_cmpeq_epi16(_mm256_and_si256(candVec, _mm256_sub_epi16(candVec, oneVec)), zeroVec);
+    __m256i newVec = _mm256_andnot_si256(foundVec, _mm256_andnot_si256(noneVec, _mm256_and_si256(openVec, singleVec)));
+    deadVec = _mm256_or_si256(deadVec, _mm256_and_si256(openVec, noneVec));
+    cellVec = _mm256_blendv_epi8(cellVec, _mm256_set1_epi16((short)p), newVec);
+    digitVec = _mm256_blendv_epi8(digitVec, candVec, newVec);
+    foundVec = _mm256_or_si256(foundVec, newVec);
+  }
+
+  // units are numbered like the passes of the bit sliced engine, rows, then columns, then boxes
+  for (u = 0; u < 27; u++) {
+    __m256i onceVec = zeroVec, twiceVec = zeroVec;
+    for (k = 0; k < 9; k++) {
+      p = bitslice_unit_cell(u, k);
+      __m256i candVec = _mm256_and_si256(load_cells(&data[p << 4]),
+                                         _mm256_cmpeq_epi16(load_cells(&givens[p << 4]), zeroVec));
+      twiceVec = _mm256_or_si256(twiceVec, _mm256_and_si256(onceVec, candVec));
+      onceVec = _mm256_or_si256(onceVec, candVec);
+    }
+
+    uint16_t *p_unit = u < 9 ? &p_rows[u << 4] : u < 18 ? &p_cols[(u - 9) << 4] : &p_boxs[(u - 18) << 4];
+    __m256i missingVec = _mm256_andnot_si256(onceVec, load_cells(p_unit));
+    deadVec = _mm256_or_si256(deadVec, _mm256_xor_si256(_mm256_cmpeq_epi16(missingVec, zeroVec), allVec));
+
+    __m256i singlesVec = _mm256_andnot_si256(twiceVec, onceVec);
+    __m256i newVec = _mm256_andnot_si256(foundVec, _mm256_xor_si256(_mm256_cmpeq_epi16(singlesVec, zeroVec), allVec));
+    if (_mm256_testz_si256(newVec, newVec))
+      continue;
+
+    // the lowest digit, and the one open cell of the unit it fits
+    __m256i bitVec = _mm256_and_si256(singlesVec, _mm256_sub_epi16(zeroVec, singlesVec));
+    for (k = 0; k < 9; k++) {
+      p = bitslice_unit_cell(u, k);
+      __m256i candVec = _mm256_and_si256(load_cells(&data[p << 4]),
+                                         _mm256_cmpeq_epi16(load_cells(&givens[p << 4]), zeroVec));
+      __m256i matchVec = _mm256_andnot_si256(_mm256_cmpeq_epi16(_mm256_and_si256(candVec, bitVec), zeroVec), newVec);
+      cellVec = _mm256_blendv_epi8(cellVec, _mm256_set1_epi16((short)p), matchVec);
+    }
+    digitVec = _mm256_blendv_epi8(digitVec, bitVec, newVec);
+    unitVec = _mm256_blendv_epi8(unitVec, _mm256_set1_epi16((short)u), newVec);
+    hiddenVec = _mm256_or_si256(hiddenVec, newVec);
+    foundVec = _mm256_or_si256(foundVec, newVec);
+  }
+
+  uint16_t cells[16], digits[16], units[16];
+  _mm256_storeu_si256((__m256i_u *)cells, cellVec);
+  _mm256_storeu_si256((__m256i_u *)digits, digitVec);
+  _mm256_storeu_si256((__m256i_u *)units, unitVec);
+  uint16_t found = lane_mask(foundVec), hidden = lane_mask(hiddenVec);
+  invalid = (invalid | lane_mask(deadVec)) & (uint16_t)((1 << count) - 1);
+
+  for (int j = 0; j < count; j++) {
+    sudoku_hint_t *hint = &hints[j];
+    memset(hint, 0, sizeof(*hint));
+    if (invalid >> j & 1) {
+      hint->kind = SUDOKU_HINT_INVALID;
+    } else if (found >> j & 1) {
+      hint->kind = hidden >> j & 1 ? SUDOKU_HINT_HIDDEN_SINGLE : SUDOKU_HINT_NAKED_SINGLE;
+      hint->cell = (uint8_t)cells[j];
+      hint->digit = (uint8_t)(_tzcnt_u32(digits[j]) + 1);
+      hint->unit = hidden >> j & 1 ? (uint8_t)units[j] : 0;
+    }
+
+    for (p = 0; candidates && p < SUDOKU_CELL_COUNT; p++)
+      candidates[j * SUDOKU_CELL_COUNT + p] = data[(p << 4) + j];
+  }
+  return invalid;
+}
+#pragma endregion
+
+#pragma region threads
+typedef struct {
+  batch_t batch;
+  int node, index;
+  size_t partitionBytes;
+  solver_stats_t stats;
+  pthread_t thread;
+} worker_t;
+
+// Splits the batch into block aligned ranges, one per worker. With numa every node gets a contiguous partition that is
+// copied into node-local memory by a thread bound to that node, so the pages are first touched there, and the node's
+// workers solve from that copy with node-local scratch. Stats are per worker and merged once all of them are joined.
+static void run_threaded(const batch_t *batch, int threadCount, int numa, solver_stats_t *stats) {
+  static worker_t workers[MAX_THREAD_COUNT];
+  worker_t partitions[MAX_THREAD_COUNT];
+  int nodeCount = numa ? numa_node_count() : 1;
+  int blockCount = batch->count >> 4, node, i;
+
+  if (nodeCount > threadCount)
+    nodeCount = threadCount;
+
+  for (node = 0; node < nodeCount; node++) {
+    int firstBlock = blockCount * node / nodeCount, lastBlock = blockCount * (node + 1) / nodeCount;
+    worker_t *partition = &partitions[node];
+
+    partition->node = node;
+    partition->batch = *batch;
+    partition->batch.count = (lastBlock - firstBlock) << 4;
+    partition->batch.padding = lastBlock == blockCount ? batch->padding : 0;
+    partition->batch.sudokus = &batch->sudokus[(size_t)(firstBlock << 4) * batch->stride];
+    if (batch->solutions)
+      partition->batch.solutions = &batch->solutions[(size_t)(firstBlock << 4) * batch->stride];
+    if (batch->output)
+      partition->batch.output = &batch->output[(size_t)(firstBlock << 4) * batch->outputStride];
+    partition->partitionBytes = 0;
+
+    if (numa)
+      pthread_create(&partition->thread, NULL, copy_partition, partition);
+  }
+  for (node = 0; numa && node < nodeCount; node++)
+    pthread_join(partitions[node].thread, NULL);
+
+  for (i = 0; i < threadCount; i++) {
+    // workers are spread round robin over the nodes, then split their node's partition evenly
+    worker_t *partition = &partitions[i % nodeCount];
+    int nodeThreads = threadCount / nodeCount + (i % nodeCount < threadCount % nodeCount);
+    int nodeIndex = i / nodeCount, nodeBlocks = partition->batch.count >> 4;
+    int firstBlock = nodeBlocks * nodeIndex / nodeThreads, lastBlock = nodeBlocks * (nodeIndex + 1) / nodeThreads;
+
+    worker_t *worker = &workers[i];
+    memset(&worker->stats, 0, sizeof(worker->stats));
+    worker->node = numa ? partition->node : -1;
+    worker->index = i;
+    worker->batch = partition->batch;
+    worker->batch.count = (lastBlock - firstBlock) << 4;
+    worker->batch.padding = lastBlock == nodeBlocks ? partition->batch.padding : 0;
+    worker->batch.sudokus = &partition->batch.sudokus[(size_t)(firstBlock << 4) * batch->stride];
+    if (batch->solutions)
+      worker->batch.solutions = &partition->batch.solutions[(size_t)(firstBlock << 4) * batch->stride];
+    if (batch->output)
+      worker->batch.output = &partition->batch.output[(size_t)(firstBlock << 4) * batch->outputStride];
+
+    pthread_create(&worker->thread, NULL, solve_worker, worker);
+  }
+
+  for (i = 0; i < threadCount; i++) {
+    pthread_join(workers[i].thread, NULL);
+    merge_stats(stats, &workers[i].stats);
+  }
+
+  for (node = 0; numa && node < nodeCount; node++) {
+    worker_t *partition = &partitions[node];
+    if (partition->batch.solutions < partition->batch.sudokus ||
+        partition->batch.solutions >= partition->batch.sudokus + partition->batch.stride)
+      free_on_node((void *)partition->batch.solutions, partition->partitionBytes, node);
+    free_on_node((void *)partition->batch.sudokus, partition->partitionBytes, node);
+  }
+}
+
+static void *solve_worker(void *arg) {
+  worker_t *worker = (worker_t *)arg;
+  if (worker->node >= 0)
+    bind_to_node(worker->node);
+  pin_thread(0, worker->index);
+
+  uint16_t *arena = alloc_block_arena(INTERLEAVED_BLOCKS, worker->node);
+  run(&worker->batch, arena, &worker->stats);
+  free_block_arena(arena, INTERLEAVED_BLOCKS, worker->node);
+  return NULL;
+}
+
+// copies a partition's records (and solutions) into memory of its node, from a thread running on that node
+static void *copy_partition(void *arg) {
+  worker_t *partition = (worker_t *)arg;
+  bind_to_node(partition->node);
+
+  size_t size = (size_t)partition->batch.count * partition->batch.stride + INPUT_PADDING;
+  uint8_t *sudokus = (uint8_t *)alloc_on_node(size, partition->node);
+  memcpy(sudokus, partition->batch.sudokus, size);
+
+  if (partition->batch.solutions) {
+    // kaggle solutions live inside the records, other layouts keep them in their own buffer
+    if (partition->batch.solutions > partition->batch.sudokus &&
+        partition->batch.solutions < partition->batch.sudokus + partition->batch.stride) {
+      partition->batch.solutions = sudokus + (partition->batch.solutions - partition->batch.sudokus);
+    } else {
+      uint8_t *solutions = (uint8_t *)alloc_on_node(size, partition->node);
+      memcpy(solutions, partition->batch.solutions, size);
+      partition->batch.solutions = solutions;
+    }
+  }
+
+  partition->batch.sudokus = sudokus;
+  partition->partitionBytes = size;
+  return NULL;
+}
+#pragma endregion
+
+#pragma region numa
+#ifdef USE_NUMA
+static int numa_node_count() { return numa_available() < 0 ? 1 : numa_max_node() + 1; }
+
+static void bind_to_node(int node) {
+  if (numa_available() >= 0)
+    numa_run_on_node(node);
+}
+
+static void *alloc_on_node(size_t size, int node) {
+  if (node < 0 || numa_available() < 0)
+    return _mm_malloc(size, 64);
+  return numa_alloc_onnode(size, node);
+}
+
+static void free_on_node(void *p, size_t size, int node) {
+  if (!p)
+    return;
+  if (node < 0 || numa_available() < 0)
+    _mm_free(p);
+  else
+    numa_free(p, size);
+}
+#else
+// without libnuma everything degrades to a single node
+static int numa_node_count() { return 1; }
+static void bind_to_node(int node) { (void)node; }
+static void *alloc_on_node(size_t size, int node) { return (void)node, _mm_malloc(size, 64); }
+static void free_on_node(void *p, size_t size, int node) { (void)size, (void)node, _mm_free(p); }
+#endif
+#pragma endregion
+
+#pragma region placement
+#ifdef __linux__
+// Groups the cpus the process may run on into physical cores by their package and core id, then hands them out to
+// threadCount solvers, and to the inflate workers for pair. More solvers than the layout has room for wrap around.
+// Returns 0 for an unknown spec.
+static int init_placement(const char *spec, int threadCount) {
+  static int coreKeys[MAX_CPU_COUNT], coreCpus[MAX_CPU_COUNT][MAX_CORE_THREADS], coreThreads[MAX_CPU_COUNT];
+  int mode, coreCount = 0, cpu, core, i;
+  for (mode = PLACEMENT_NONE; mode <= PLACEMENT_PAIR && strcmp(spec, placementNames[mode]); mode++)
+    ;
+  if (mode > PLACEMENT_PAIR)
+    return 0;
+
+  cpu_set_t allowed;
+  if (sched_getaffinity(0, sizeof(allowed), &allowed))
+    return 0;
+  for (cpu = 0; cpu < CPU_SETSIZE && cpu < MAX_CPU_COUNT; cpu++) {
+    if (!CPU_ISSET(cpu, &allowed))
+      continue;
+    // a cpu without topology in sysfs is a core of its own
+    int package = topology_id(cpu, "physical_package_id"), id = topology_id(cpu, "core_id");
+    int key = package < 0 || id < 0 ? -1 - cpu : (package << 16) + id;
+    for (core = 0; core < coreCount && coreKeys[core] != key; core++)
+      ;
+    if (core == coreCount) {
+      coreKeys[coreCount] = key;
+      coreThreads[coreCount++] = 0;
+    }
+    if (coreThreads[core] < MAX_CORE_THREADS)
+      coreCpus[core][coreThreads[core]++] = cpu;
+  }
+  if (!coreCount)
+    return 0;
+
+  placement.mode = mode;
+  placement.coreCount = coreCount;
+  for (i = 0; i < threadCount; i++) {
+    int thread;
+    if (mode == PLACEMENT_SMT)
+      core = i / 2 % coreCount, thread = i % 2;
+    else
+      core = i % coreCount, thread = mode == PLACEMENT_CORES ? i / coreCount : 0;
+    placement.solverCpus[i] = coreCpus[core][thread % coreThreads[core]];
+    placement.helperCpus[i] = mode == PLACEMENT_PAIR ? coreCpus[core][1 % coreThreads[core]] : -1;
+  }
+  return 1;
+}
+
+// an id from /sys/devices/system/cpu/cpu<n>/topology, -1 if it is not there
+static int topology_id(int cpu, const char *name) {
+  char path[128];
+  int id = -1;
+  snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/topology/%s", cpu, name);
+  FILE *fp = fopen(path, "r");
+  if (fp) {
+    if (fscanf(fp, "%d", &id) != 1)
+      id = -1;
+    fclose(fp);
+  }
+  return id;
+}
+
+// pins the calling thread to the cpu of solver (or inflate worker, for helper) index
+static void pin_thread(int helper, int index) {
+  int cpu = helper ? placement.helperCpus[index] : placement.solverCpus[index];
+  if (!placement.mode || cpu < 0)
+    return;
+
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(cpu, &set);
+  pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+}
+#else
+// without sched_setaffinity nothing is pinned, and only none is accepted
+static int init_placement(const char *spec, int threadCount) { return (void)threadCount, !strcmp(spec, "none"); }
+static int topology_id(int cpu, const char *name) { return (void)cpu, (void)name, -1; }
+static void pin_thread(int helper, int index) { (void)helper, (void)index; }
+#endif
+
+static void print_placement(int threadCount) {
+  int i;
+  printf("Placement: %s over %d cores, solvers on cpus", placementNames[placement.mode], placement.coreCount);
+  for (i = 0; i < threadCount; i++)
+    printf(" %d", placement.solverCpus[i]);
+  if (placement.mode == PLACEMENT_PAIR) {
+    printf(", inflate workers on cpus");
+    for (i = 0; i < threadCount; i++)
+      printf(" %d", placement.helperCpus[i]);
+  }
+  printf("\n");
+}
+#pragma endregion
+
+#pragma region input
+// the file (or the bytes from rangeStart up to rangeEnd, -1 for the end) is read with INPUT_PADDING spare bytes and room
+// to pad the last block to 16 kaggle records
+static uint8_t *read_input(const char *path, long rangeStart, long rangeEnd, size_t *length) {
+  FILE *fp = fopen(path, "rb");
+  if (!fp)
+    return NULL;
+
+  fseek(fp, 0, SEEK_END);
+  long fileLength = ftell(fp);
+  if (rangeEnd < 0 || rangeEnd > fileLength)
+    rangeEnd = fileLength;
+  *length = rangeStart < rangeEnd ? (size_t)(rangeEnd - rangeStart) : 0;
+  fseek(fp, rangeStart, SEEK_SET);
+
+  uint8_t *bytes = (uint8_t *)malloc(*length + 16 * BYTES_FOR_1_SUDOKUS + INPUT_PADDING);
+  if (bytes)
+    *length = fread(bytes, sizeof(uint8_t), *length, fp);
+
+  fclose(fp);
+  return bytes;
+}
+
+// Input in the exact kaggle layout is solved in place. Anything else (a header or '#' comments, '.' blanks, CRLF, no
+// solution column) goes through parse_records into packed records first. A shard after the first has no header to
+// skip. Returns the number of sudokus.
+static int load_batch(uint8_t *bytes, size_t length, int skipHeader, batch_t *batch) {
+  size_t start, solutionCount = 0;
+  int inPlace = kaggle_layout(bytes, length, skipHeader, &start);
+
+  const uint8_t *records = bytes + start;
+  size_t recordBytes = length - start;
+  size_t count;
+
+  if (inPlace) {
+    count = recordBytes / BYTES_FOR_1_SUDOKUS;
+    batch->sudokus = records;
+    batch->solutions = records + SUDOKU_CELL_COUNT + 1;
+    batch->stride = BYTES_FOR_1_SUDOKUS;
+    pad_batch((uint8_t *)records, NULL, (int)count, BYTES_FOR_1_SUDOKUS, 1);
+  } else {
+    size_t capacity = (count_lines(records, recordBytes) + 16) * PACKED_BYTES_FOR_1_SUDOKUS;
+    uint8_t *puzzles = (uint8_t *)_mm_malloc(capacity, 64), *solutions = (uint8_t *)_mm_malloc(capacity, 64);
+
+    count = parse_records(records, recordBytes, puzzles, solutions, &solutionCount);
+    if (solutionCount != count) {
+      _mm_free(solutions);
+      solutions = NULL;
+    }
+
+    batch->sudokus = puzzles;
+    batch->solutions = solutions;
+    batch->stride = PACKED_BYTES_FOR_1_SUDOKUS;
+    pad_batch(puzzles, solutions, (int)count, PACKED_BYTES_FOR_1_SUDOKUS, 0);
+  }
+
+  batch->output = NULL;
+  batch->outputStride = BYTES_FOR_1_SUDOKUS;
+  batch->count = (int)((count + 15) & ~(size_t)15);
+  batch->padding = batch->count - (int)count;
+  return (int)count;
+}
+
+// whether load_batch solves the input in place, which only takes the first record and the last byte. '.' blanks in a
+// later record are turned into '0' by prepare_block. start gets the offset of the first record, past the header if
+// there is one to skip.
+static int kaggle_layout(const uint8_t *bytes, size_t length, int skipHeader, size_t *start) {
+  *start = 0;
+  if (skipHeader && length && !(bytes[0] >= '0' && bytes[0] <= '9') && bytes[0] != '.')
+    *start = find_newline(bytes, 0, length) + 1;
+  if (*start > length)
+    *start = length;
+
+  const uint8_t *records = bytes + *start;
+  size_t recordBytes = length - *start;
+  return recordBytes && recordBytes % BYTES_FOR_1_SUDOKUS == 0 && records[SUDOKU_CELL_COUNT] == ',' &&
+         records[BYTES_FOR_1_SUDOKUS - 1] == '\n' && records[recordBytes - 1] == '\n' &&
+         memchr(records, '.', BYTES_FOR_1_SUDOKUS) == NULL;
+}
+
+// Scans the newlines with AVX2 and writes one packed record per puzzle line. Blank lines and '#' comments are skipped,
+// a line shorter than 81 cells is kept with '?' filler so the record is rejected instead of shifting the others.
+static size_t parse_records(const uint8_t *bytes, size_t length, uint8_t *puzzles, uint8_t *solutions,
+                            size_t *solutionCount) {
+  __m256i_u newlineVec = _mm256_set1_epi8('\n');
+  size_t pos, lineStart = 0, count = 0;
+  *solutionCount = 0;
+
+  for (pos = 0; pos < length; pos += 32) {
+    uint32_t mask;
+    if (pos + 32 <= length) {
+      mask = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256((__m256i_u *)&bytes[pos]), newlineVec));
+    } else {
+      mask = 0;
+      for (size_t i = pos; i < length; i++)
+        mask |= (uint32_t)(bytes[i] == '\n') << (i - pos);
+    }
+
+    for (; mask; mask = _blsr_u32(mask)) {
+      size_t end = pos + _tzcnt_u32(mask);
+      count += parse_line(&bytes[lineStart], end - lineStart, &puzzles[count * PACKED_BYTES_FOR_1_SUDOKUS],
+                          &solutions[count * PACKED_BYTES_FOR_1_SUDOKUS], solutionCount);
+      lineStart = end + 1;
+    }
+  }
+
+  if (lineStart < length) {
+    count += parse_line(&bytes[lineStart], length - lineStart, &puzzles[count * PACKED_BYTES_FOR_1_SUDOKUS],
+                        &solutions[count * PACKED_BYTES_FOR_1_SUDOKUS], solutionCount);
+  }
+
+  _mm_sfence();
+  return count;
+}
+
+// returns 1 if the line held a record
+static inline int parse_line(const uint8_t *line, size_t lineLength, uint8_t *puzzle, uint8_t *solution,
+                             size_t *solutionCount) {
+  if (lineLength && line[lineLength - 1] == '\r')
+    --lineLength;
+
+  if (!lineLength || line[0] == '#')
+    return 0;
+
+  if (lineLength >= SUDOKU_CELL_COUNT) {
+    normalize_cells(line, puzzle);
+  } else {
+    memset(puzzle, '?', PACKED_BYTES_FOR_1_SUDOKUS);
+    memcpy(puzzle, line, lineLength);
+  }
+
+  // the solution column follows after a single separator
+  if (lineLength >= 2 * SUDOKU_CELL_COUNT + 1) {
+    normalize_cells(line + SUDOKU_CELL_COUNT + 1, solution);
+    ++*solutionCount;
+  }
+
+  return 1;
+}
+
+// returns the position of the next '\n' at or after pos, or length if there is none
+static inline size_t find_newline(const uint8_t *bytes, size_t pos, size_t length) {
+  __m256i_u newlineVec = _mm256_set1_epi8('\n');
+
+  for (; pos + 32 <= length; pos += 32) {
+    uint32_t mask = (uint32_t)_mm256_movemask_epi8(
+        _mm256_cmpeq_epi8(_mm256_loadu_si256((__m256i_u *)&bytes[pos]), newlineVec));
+    if (mask)
+      return pos + _tzcnt_u32(mask);
+  }
+
+  for (; pos < length; pos++) {
+    if (bytes[pos] == '\n')
+      return pos;
+  }
+  return length;
+}
+
+static size_t count_lines(const uint8_t *bytes, size_t length) {
+  __m256i_u newlineVec = _mm256_set1_epi8('\n');
+  size_t pos = 0, count = 1;
+
+  for (; pos + 32 <= length; pos += 32) {
+    count += _mm_popcnt_u32((uint32_t)_mm256_movemask_epi8(
+        _mm256_cmpeq_epi8(_mm256_loadu_si256((__m256i_u *)&bytes[pos]), newlineVec)));
+  }
+  for (; pos < length; pos++)
+    count += bytes[pos] == '\n';
+
+  return count;
+}
+
+// copies the 81 cells of a record into an aligned packed record and turns '.' blanks into '0', the 15 bytes after the
+// cells are copied along and never read
+static inline void normalize_cells(const uint8_t *src, uint8_t *dest) {
+  __m256i_u dotVec = _mm256_set1_epi8('.');
+  __m256i_u zeroCharVec = _mm256_set1_epi8('0');
+
+  for (int i = 0; i < PACKED_BYTES_FOR_1_SUDOKUS; i += 32) {
+    __m256i_u cellVec = _mm256_loadu_si256((__m256i_u *)&src[i]);
+    cellVec = _mm256_blendv_epi8(cellVec, zeroCharVec, _mm256_cmpeq_epi8(cellVec, dotVec));
+    _mm256_stream_si256((__m256i *)&dest[i], cellVec);
+  }
+}
+
+// fills the last block up to 16 sudokus with an already solved grid, which costs nothing to solve or validate. The grid
+// also keeps the diagonals, windows and disjoint groups, so it is solved for every variant.
+static void pad_batch(uint8_t *sudokus, uint8_t *solutions, int count, int stride, int kaggleLayout) {
+  static const char *solvedGrid =
+      "214876935678935124935214687541687392367592841829143576153728469786459213492361758";
+
+  for (int i = count; i & 15; i++) {
+    uint8_t *record = &sudokus[i * stride];
+    memcpy(record, solvedGrid, SUDOKU_CELL_COUNT);
+
+    if (kaggleLayout) {
+      record[SUDOKU_CELL_COUNT] = ',';
+      memcpy(&record[SUDOKU_CELL_COUNT + 1], solvedGrid, SUDOKU_CELL_COUNT);
+      record[BYTES_FOR_1_SUDOKUS - 1] = '\n';
+    } else if (solutions) {
+      memcpy(&solutions[i * stride], solvedGrid, SUDOKU_CELL_COUNT);
+    }
+  }
+}
+#pragma endregion
+
+#pragma region compressed input
+static int compression_format(const uint8_t *bytes, size_t length) {
+  if (length >= 2 && bytes[0] == 0x1F && bytes[1] == 0x8B)
+    return COMPRESSION_GZIP;
+  if (length >= 4 && bytes[0] == 0x28 && bytes[1] == 0xB5 && bytes[2] == 0x2F && bytes[3] == 0xFD)
+    return COMPRESSION_ZSTD;
+  return COMPRESSION_NONE;
+}
+
+static int compressed_file(const char *path) {
+  uint8_t head[4];
+  FILE *fp = fopen(path, "rb");
+  if (!fp)
+    return 0;
+  size_t headLength = fread(head, 1, sizeof(head), fp);
+  fclose(fp);
+  return compression_format(head, headLength) != COMPRESSION_NONE;
+}
+
+// Finds the chunks, allocates the buffer they inflate into with the padding read_input leaves, and starts the workers.
+// A gzip input inflates in parallel when it is BGZF, as bgzip writes it: members with their size in a BC extra field. A
+// zstd input when it has several frames with their content size, or a seek table. Anything else is one chunk.
+static int start_inflate(const uint8_t *compressed, size_t length, int threadCount, inflater_t *inflater) {
+  memset(inflater, 0, sizeof(*inflater));
+  inflater->compressed = compressed;
+  inflater->format = compression_format(compressed, length);
+  if ((inflater->format == COMPRESSION_GZIP ? find_gzip_chunks(inflater, length) : find_zstd_chunks(inflater, length)) ||
+      !inflater->chunkCount)
+    return -1;
+
+  chunk_t *last = &inflater->chunks[inflater->chunkCount - 1];
+  inflater->length = last->outputOffset + last->outputLength;
+  inflater->bytes = (uint8_t *)malloc(inflater->length + 16 * BYTES_FOR_1_SUDOKUS + INPUT_PADDING);
+  inflater->done = (uint8_t *)calloc(inflater->chunkCount, 1);
+  if (!inflater->bytes || !inflater->done)
+    return -1;
+
+  pthread_mutex_init(&inflater->lock, NULL);
+  pthread_cond_init(&inflater->ready, NULL);
+  inflater->threadCount = threadCount < inflater->chunkCount ? threadCount : inflater->chunkCount;
+  for (int i = 0; i < inflater->threadCount; i++)
+    pthread_create(&inflater->threads[i], NULL, inflate_worker, inflater);
+  return 0;
+}
+
+#if defined(USE_ZLIB) || defined(USE_ZSTD)
+// appends a chunk that inflates to outputLength bytes, empty ones are left out
+static int add_chunk(inflater_t *inflater, size_t offset, size_t length, size_t outputLength, uint32_t crc) {
+  if (!outputLength)
+    return 0;
+  if (inflater->chunkCount == inflater->chunkCapacity) {
+    int capacity = inflater->chunkCapacity ? inflater->chunkCapacity << 1 : 1024;
+    chunk_t *chunks = (chunk_t *)realloc(inflater->chunks, capacity * sizeof(chunk_t));
+    if (!chunks)
+      return -1;
+    inflater->chunks = chunks;
+    inflater->chunkCapacity = capacity;
+  }
+
+  size_t outputOffset = inflater->chunkCount ? inflater->chunks[inflater->chunkCount - 1].outputOffset +
+                                                   inflater->chunks[inflater->chunkCount - 1].outputLength
+                                             : 0;
+  inflater->chunks[inflater->chunkCount++] = (chunk_t){offset, length, outputOffset, outputLength, crc};
+  return 0;
+}
+#endif
+
+static inline uint32_t read_le32(const uint8_t *p) {
+  return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+// a BGZF member is a 12 byte header, the extra field, raw deflate data, the crc32 and the inflated size
+static int find_gzip_chunks(inflater_t *inflater, size_t length) {
+#ifdef USE_ZLIB
+  const uint8_t *bytes = inflater->compressed;
+  size_t pos = 0;
+  int members = 0;
+
+  while (pos + 18 <= length && bytes[pos] == 0x1F && bytes[pos + 1] == 0x8B && bytes[pos + 3] & 4) {
+    size_t extraLength = bytes[pos + 10] | (size_t)bytes[pos + 11] << 8, memberLength = 0;
+    for (size_t field = pos + 12; field + 6 <= pos + 12 + extraLength;
+         field += 4 + (bytes[field + 2] | (size_t)bytes[field + 3] << 8)) {
+      if (bytes[field] == 'B' && bytes[field + 1] == 'C')
+        memberLength = (bytes[field + 4] | (size_t)bytes[field + 5] << 8) + 1;
+    }
+    if (!memberLength || pos + memberLength > length || memberLength < 12 + extraLength + 8)
+      break;
+
+    if (add_chunk(inflater, pos + 12 + extraLength, memberLength - 12 - extraLength - 8,
+                  read_le32(&bytes[pos + memberLength - 4]), read_le32(&bytes[pos + memberLength - 8])))
+      return -1;
+    pos += memberLength;
+    ++members;
+  }
+
+  if (members) {
+    inflater->raw = 1;
+    if (pos == length)
+      return 0;
+    printf("BGZF member at byte %zu is broken\n", pos);
+    return -1;
+  }
+
+  // a plain gzip file has the inflated size, modulo 4GB, in its last 4 bytes
+  return length < 18 ? -1 : add_chunk(inflater, 0, length, read_le32(&bytes[length - 4]), 0);
+#else
+  (void)inflater, (void)length;
+  printf("gzip input needs a build with USE_ZLIB\n");
+  return -1;
+#endif
+}
+
+// the zstd seekable format ends with a skippable frame holding the compressed and inflated size of every frame
+static int find_zstd_chunks(inflater_t *inflater, size_t length) {
+#ifdef USE_ZSTD
+  const uint8_t *bytes = inflater->compressed;
+  size_t pos = 0;
+
+  if (length >= 9 && read_le32(&bytes[length - 4]) == 0x8F92EAB1) {
+    size_t frameCount = read_le32(&bytes[length - 9]), entryLength = bytes[length - 5] & 0x80 ? 12 : 8;
+    if (frameCount * entryLength + 9 > length)
+      return -1;
+    const uint8_t *entry = &bytes[length - 9 - frameCount * entryLength];
+    for (size_t i = 0; i < frameCount; i++, entry += entryLength) {
+      if (add_chunk(inflater, pos, read_le32(entry), read_le32(entry + 4), 0))
+        return -1;
+      pos += read_le32(entry);
+    }
+    return pos <= length ? 0 : -1;
+  }
+
+  while (pos < length) {
+    size_t frameLength = ZSTD_findFrameCompressedSize(&bytes[pos], length - pos);
+    if (ZSTD_isError(frameLength))
+      return -1;
+
+    if ((read_le32(&bytes[pos]) & 0xFFFFFFF0) != 0x184D2A50) {
+      unsigned long long outputLength = ZSTD_getFrameContentSize(&bytes[pos], length - pos);
+      if (outputLength == ZSTD_CONTENTSIZE_UNKNOWN || outputLength == ZSTD_CONTENTSIZE_ERROR) {
+        printf("zstd frame at byte %zu has no content size\n", pos);
+        return -1;
+      }
+      if (add_chunk(inflater, pos, frameLength, (size_t)outputLength, 0))
+        return -1;
+    }
+    pos += frameLength;
+  }
+  return 0;
+#else
+  (void)inflater, (void)length;
+  printf("zstd input needs a build with USE_ZSTD\n");
+  return -1;
+#endif
+}
+
+static void *inflate_worker(void *arg) {
+  inflater_t *inflater = (inflater_t *)arg;
+  pthread_mutex_lock(&inflater->lock);
+  int index = inflater->startedThreads++;
+  pthread_mutex_unlock(&inflater->lock);
+  pin_thread(1, index);
+
+#ifdef USE_ZLIB
+  z_stream stream;
+  memset(&stream, 0, sizeof(stream));
+  // raw deflate for BGZF members, a gzip wrapper that checks itself for a plain file
+  int zlibReady = inflater->format != COMPRESSION_GZIP || inflateInit2(&stream, inflater->raw ? -15 : 15 + 16) == Z_OK;
+#endif
+#ifdef USE_ZSTD
+  ZSTD_DCtx *context = inflater->format == COMPRESSION_ZSTD ? ZSTD_createDCtx() : NULL;
+#endif
+
+  for (;;) {
+    pthread_mutex_lock(&inflater->lock);
+    int claim = inflater->nextChunk++, count = inflater->chunkCount;
+    pthread_mutex_unlock(&inflater->lock);
+    if (claim >= count)
+      break;
+
+    int i = claim == 0 ? 0 : claim == 1 ? count - 1 : claim - 1;
+    int ok = 0;
+
+#ifdef USE_ZLIB
+    if (inflater->format == COMPRESSION_GZIP && zlibReady) {
+      const chunk_t *chunk = &inflater->chunks[i];
+      uint8_t *dest = &inflater->bytes[chunk->outputOffset];
+      stream.next_in = (Bytef *)&inflater->compressed[chunk->offset];
+      stream.avail_in = (uInt)chunk->length;
+      stream.next_out = dest;
+      stream.avail_out = (uInt)chunk->outputLength;
+      ok = inflate(&stream, Z_FINISH) == Z_STREAM_END && !stream.avail_out && !stream.avail_in &&
+           (!inflater->raw || crc32(crc32(0, NULL, 0), dest, (uInt)chunk->outputLength) == chunk->crc);
+      inflateReset(&stream);
+    }
+#endif
+#ifdef USE_ZSTD
+    if (inflater->format == COMPRESSION_ZSTD && context) {
+      const chunk_t *chunk = &inflater->chunks[i];
+      size_t inflated = ZSTD_decompressDCtx(context, &inflater->bytes[chunk->outputOffset], chunk->outputLength,
+                                            &inflater->compressed[chunk->offset], chunk->length);
+      ok = !ZSTD_isError(inflated) && inflated == chunk->outputLength;
+    }
+#endif
+
+    pthread_mutex_lock(&inflater->lock);
+    inflater->done[i] = 1;
+    inflater->failed |= !ok;
+    while (inflater->readyChunks < count && inflater->done[inflater->readyChunks])
+      ++inflater->readyChunks;
+    pthread_cond_broadcast(&inflater->ready);
+    pthread_mutex_unlock(&inflater->lock);
+  }
+
+#ifdef USE_ZLIB
+  if (inflater->format == COMPRESSION_GZIP && zlibReady)
+    inflateEnd(&stream);
+#endif
+#ifdef USE_ZSTD
+  ZSTD_freeDCtx(context);
+#endif
+  return NULL;
+}
+
+// waits until the bytes before end and the last chunk are inflated, returns -1 if a chunk failed
+static int wait_inflated(inflater_t *inflater, size_t end) {
+  pthread_mutex_lock(&inflater->lock);
+  for (;;) {
+    int ready = inflater->readyChunks;
+    size_t readyLength = ready == inflater->chunkCount ? inflater->length : inflater->chunks[ready].outputOffset;
+    if (inflater->failed || (readyLength >= end && inflater->done[inflater->chunkCount - 1]))
+      break;
+    pthread_cond_wait(&inflater->ready, &inflater->lock);
+  }
+  int failed = inflater->failed;
+  pthread_mutex_unlock(&inflater->lock);
+  return failed ? -1 : 0;
+}
+
+// joins the workers and frees the compressed input, returns -1 if a chunk failed
+static int finish_inflate(inflater_t *inflater) {
+  for (int i = 0; i < inflater->threadCount; i++)
+    pthread_join(inflater->threads[i], NULL);
+  pthread_mutex_destroy(&inflater->lock);
+  pthread_cond_destroy(&inflater->ready);
+  free((void *)inflater->compressed);
+  free(inflater->chunks);
+  free(inflater->done);
+  return inflater->failed ? -1 : 0;
+}
+
+// solves the batch in segments of INFLATE_SEGMENT_BLOCKS blocks, each as soon as its records are inflated
+static void run_inflating(const batch_t *batch, inflater_t *inflater, int threadCount, int numa,
+                          solver_stats_t *stats) {
+  uint16_t *arena = threadCount == 1 && !numa ? alloc_block_arena(INTERLEAVED_BLOCKS, -1) : NULL;
+  batch_t segment = *batch;
+
+  for (int done = 0; done < batch->count; done += segment.count) {
+    segment.count = batch->count - done < INFLATE_SEGMENT_BLOCKS << 4 ? batch->count - done
+                                                                        : INFLATE_SEGMENT_BLOCKS << 4;
+    segment.padding = done + segment.count == batch->count ? batch->padding : 0;
+    segment.sudokus = &batch->sudokus[(size_t)done * batch->stride];
+    if (batch->solutions)
+      segment.solutions = &batch->solutions[(size_t)done * batch->stride];
+    if (batch->output)
+      segment.output = &batch->output[(size_t)done * batch->outputStride];
+
+    // a failed chunk leaves garbage that is rejected, finish_inflate reports it
+    size_t end = (size_t)(&segment.sudokus[(size_t)segment.count * batch->stride] - inflater->bytes) + INPUT_PADDING;
+    wait_inflated(inflater, end < inflater->length ? end : inflater->length);
+
+    if (arena)
+      run(&segment, arena, stats);
+    else
+      run_threaded(&segment, threadCount, numa, stats);
+  }
+
+  if (arena)
+    free_block_arena(arena, INTERLEAVED_BLOCKS, -1);
+}
+#pragma endregion
+
+#pragma region output
+// Writes the kaggle layout for a block: the puzzle as it was read, a comma and the solution. With an outputStride of
+// SUDOKU_CELL_COUNT only the solutions are written, back to back. Lanes that were rejected or failed validation get a
+// solution of '0's.
+static void write_solutions(const uint8_t *sudokus, int stride, const uint16_t *data, uint16_t failed,
+                            uint8_t *output, int outputStride) {
+  if (outputStride == BYTES_FOR_1_SUDOKUS) {
+    // records filled in place already hold the puzzle, the comma and the newline
+    for (int i = 0; output != sudokus && i < 16; i++) {
+      uint8_t *record = &output[i * BYTES_FOR_1_SUDOKUS];
+      memcpy(record, &sudokus[i * stride], SUDOKU_CELL_COUNT);
+      record[SUDOKU_CELL_COUNT] = ',';
+      record[BYTES_FOR_1_SUDOKUS - 1] = '\n';
+    }
+    output += SUDOKU_CELL_COUNT + 1;
+  }
+
+  untransform_sudokus(data, output, outputStride);
+
+  for (; failed; failed = (uint16_t)_blsr_u32(failed))
+    memset(&output[_tzcnt_u32(failed) * outputStride], '0', SUDOKU_CELL_COUNT);
+}
+
+// inverse of transform_sudokus, 16 cells of 16 lanes at a time, writes open cells as '0'
+static inline void untransform_sudokus(const uint16_t *data, uint8_t *dest, int stride) {
+  __m128i rows[16];
+  int i, j;
+
+  for (i = 0; i < 80; i += 16) {
+    for (j = 0; j < 16; j++)
+      rows[j] = cells_to_chars(load_cells(&data[(i + j) << 4]));
+
+    transpose16x16(rows);
+
+    for (j = 0; j < 16; j++)
+      _mm_storeu_si128((__m128i_u *)&dest[j * stride + i], rows[j]);
+  }
+
+  uint8_t lastCells[16];
+  _mm_storeu_si128((__m128i_u *)lastCells, cells_to_chars(load_cells(&data[80 << 4])));
+  for (j = 0; j < 16; j++)
+    dest[j * stride + 80] = lastCells[j];
+}
+
+// a single candidate bit 1 << k converted to float has exponent 127 + k, so the digit is the exponent - 126
+static inline __m128i cells_to_chars(__m256i_u cellVec) {
+  __m256i_u biasVec = _mm256_set1_epi32(126 - '0');
+  __m256i_u lo = _mm256_cvtepu16_epi32(_mm256_castsi256_si128(cellVec));
+  __m256i_u hi = _mm256_cvtepu16_epi32(_mm256_extracti128_si256(cellVec, 1));
+
+  lo = _mm256_sub_epi32(_mm256_srli_epi32(_mm256_castps_si256(_mm256_cvtepi32_ps(lo)), 23), biasVec);
+  hi = _mm256_sub_epi32(_mm256_srli_epi32(_mm256_castps_si256(_mm256_cvtepi32_ps(hi)), 23), biasVec);
+
+  // an open cell comes out negative and saturates to 0
+  __m256i_u words = _mm256_permute4x64_epi64(_mm256_packus_epi32(lo, hi), 0b11011000);
+  __m128i chars = _mm_packus_epi16(_mm256_castsi256_si128(words), _mm256_extracti128_si256(words, 1));
+  return _mm_max_epu8(chars, _mm_set1_epi8('0'));
+}
+
+// four rounds of interleaving row i with row i + 8 transpose 16x16 bytes
+static inline void transpose16x16(__m128i *rows) {
+  __m128i tmp[16];
+
+  for (int round = 0; round < 4; round++) {
+    for (int i = 0; i < 8; i++) {
+      tmp[i << 1] = _mm_unpacklo_epi8(rows[i], rows[i + 8]);
+      tmp[(i << 1) + 1] = _mm_unpackhi_epi8(rows[i], rows[i + 8]);
+    }
+    memcpy(rows, tmp, sizeof(tmp));
+  }
+}
+#pragma endregion
+
+#pragma region cross cell engine
+// A block with only a few puzzles would spend most of solve16sudokus on empty lanes, so those puzzles are solved one at
+// a time. A fuller block is padded in a copy, the caller's records are left as they are. Returns a bit per lane that
+// was rejected or found unsolvable, like solve16sudokus.
+static uint16_t solve_block(const uint8_t *sudokus, int stride, int count, uint8_t *output, uint16_t *data,
+                            solver_stats_t *stats) {
+  if (count > CROSS_CELL_MAX_LANES || variant.unitCount) {
+    alignas(32) uint8_t padded[16 * PACKED_BYTES_FOR_1_SUDOKUS + INPUT_PADDING] = {0};
+    for (int i = 0; i < count; i++)
+      memcpy(&padded[i * PACKED_BYTES_FOR_1_SUDOKUS], &sudokus[i * stride], SUDOKU_CELL_COUNT);
+    pad_batch(padded, NULL, count, PACKED_BYTES_FOR_1_SUDOKUS, 0);
+    return solve16sudokus(padded, NULL, PACKED_BYTES_FOR_1_SUDOKUS, output, BYTES_FOR_1_SUDOKUS, data, stats);
+  }
+
+  return solve_cross_cell_lanes(sudokus, NULL, stride, count, output, BYTES_FOR_1_SUDOKUS, stats);
+}
+
+// Solves count puzzles with the cross cell engine and writes them like write_solutions, at most one failed block is
+// counted for them. Returns a bit per puzzle that was rejected or found unsolvable.
+static uint16_t solve_cross_cell_lanes(const uint8_t *sudokus, const uint8_t *solutions, int stride, int count,
+                                       uint8_t *output, int outputStride, solver_stats_t *stats) {
+  uint8_t solution[SUDOKU_CELL_COUNT];
+  uint16_t failed = 0;
+  int wrong = 0;
+
+  for (int i = 0; i < count; i++) {
+    if (!solve_cross_cells(&sudokus[i * stride], solution)) {
+      memset(solution, '0', SUDOKU_CELL_COUNT);
+      failed |= (uint16_t)(1 << i);
+      ++stats->rejectedLanes;
+    }
+#ifdef CHECK_SOLUTIONS
+    else if (solutions && memcmp(solution, &solutions[i * stride], SUDOKU_CELL_COUNT)) {
+      wrong = 1;
+    }
+#endif
+    if (!output)
+      continue;
+
+    uint8_t *record = &output[i * outputStride];
+    if (outputStride == BYTES_FOR_1_SUDOKUS && record != &sudokus[i * stride]) {
+      memcpy(record, &sudokus[i * stride], SUDOKU_CELL_COUNT);
+      record[SUDOKU_CELL_COUNT] = ',';
+      record[BYTES_FOR_1_SUDOKUS - 1] = '\n';
+    }
+    if (outputStride == BYTES_FOR_1_SUDOKUS)
+      record += SUDOKU_CELL_COUNT + 1;
+    memcpy(record, solution, SUDOKU_CELL_COUNT);
+  }
+
+  stats->failedBlocks += wrong;
+  stats->crossCellPuzzles += count;
+  return failed;
+}
+
+// One puzzle lives in 9 vectors, a row per vector. Column c sits in lane c / 3 * 4 + c % 3, so every box of a row is
+// in a group of 4 lanes with an empty fourth lane, and rows and boxes reduce with in-lane butterflies. Columns reduce
+// across the vectors. Returns 1 and writes the 81 digits to solution if the puzzle is well formed and has a solution.
+static int solve_cross_cells(const uint8_t *puzzle, uint8_t *solution) {
+  uint16_t cells[9][16], rowGivens[9] = {0}, colGivens[9] = {0}, boxGivens[9] = {0};
+  __m256i_u rows[9];
+  int r, c;
+
+  // propagation only notices a duplicate once its unit is full, so duplicate givens are rejected up front
+  memset(cells, 0, sizeof(cells));
+  for (r = 0; r < 9; r++) {
+    for (c = 0; c < 9; c++) {
+      uint8_t ch = puzzle[r * 9 + c] == '.' ? '0' : puzzle[r * 9 + c];
+      if (ch < '0' || ch > '9')
+        return 0;
+
+      uint16_t bit = ch == '0' ? 0x1FF : (uint16_t)(1 << (ch - '1'));
+      if (ch != '0') {
+        int b = r / 3 * 3 + c / 3;
+        if ((rowGivens[r] | colGivens[c] | boxGivens[b]) & bit)
+          return 0;
+        rowGivens[r] |= bit;
+        colGivens[c] |= bit;
+        boxGivens[b] |= bit;
+      }
+      cells[r][c / 3 * 4 + c % 3] = bit;
+    }
+    rows[r] = _mm256_loadu_si256((__m256i_u *)cells[r]);
+  }
+
+  if (!search_cross_cells(rows))
+    return 0;
+
+  for (r = 0; r < 9; r++) {
+    uint8_t chars[16];
+    _mm_storeu_si128((__m128i_u *)chars, cells_to_chars(rows[r]));
+    for (c = 0; c < 9; c++)
+      solution[r * 9 + c] = chars[c / 3 * 4 + c % 3];
+  }
+  return 1;
+}
+
+// lane i is combined with lane i ^ 1 and i ^ 2 for a box, and also i ^ 4 and i ^ 8 for a row
+static inline __m256i_u or_box_lanes(__m256i_u v, __m256i_u swapPairsVec) {
+  v = _mm256_or_si256(v, _mm256_shuffle_epi8(v, swapPairsVec));
+  return _mm256_or_si256(v, _mm256_shuffle_epi32(v, 0b10110001));
+}
+
+static inline __m256i_u or_row_lanes(__m256i_u v, __m256i_u swapPairsVec) {
+  v = _mm256_or_si256(v, _mm256_permute2x128_si256(v, v, 1));
+  v = _mm256_or_si256(v, _mm256_shuffle_epi32(v, 0b01001110));
+  return or_box_lanes(v, swapPairsVec);
+}
+
+// a unit reduces to the digits seen at least once and the digits seen at least twice
+static inline void combine_units(__m256i_u *once, __m256i_u *twice, __m256i_u otherOnce, __m256i_u otherTwice) {
+  *twice = _mm256_or_si256(_mm256_or_si256(*twice, otherTwice), _mm256_and_si256(*once, otherOnce));
+  *once = _mm256_or_si256(*once, otherOnce);
+}
+
+static inline void combine_box_lanes(__m256i_u *once, __m256i_u *twice, __m256i_u swapPairsVec) {
+  combine_units(once, twice, _mm256_shuffle_epi8(*once, swapPairsVec), _mm256_shuffle_epi8(*twice, swapPairsVec));
+  combine_units(once, twice, _mm256_shuffle_epi32(*once, 0b10110001), _mm256_shuffle_epi32(*twice, 0b10110001));
+}
+
+static inline void combine_row_lanes(__m256i_u *once, __m256i_u *twice, __m256i_u swapPairsVec) {
+  combine_units(once, twice, _mm256_permute2x128_si256(*once, *once, 1), _mm256_permute2x128_si256(*twice, *twice, 1));
+  combine_units(once, twice, _mm256_shuffle_epi32(*once, 0b01001110), _mm256_shuffle_epi32(*twice, 0b01001110));
+  combine_box_lanes(once, twice, swapPairsVec);
+}
+
+// Eliminates the digits of solved cells from their peers until nothing changes, then places digits that fit only one
+// cell of a unit, and starts over. Returns 0 on a contradiction: an empty cell or a digit missing from a unit, which
+// is also how a digit solved twice in a unit shows up once the unit is full.
+static int propagate_cross_cells(__m256i_u *rows) {
+  __m256i_u zeroVec = _mm256_setzero_si256(), oneVec = _mm256_set1_epi16(1);
+  __m256i_u validVec = _mm256_setr_epi16(0x1FF, 0x1FF, 0x1FF, 0, 0x1FF, 0x1FF, 0x1FF, 0, 0x1FF, 0x1FF, 0x1FF, 0, 0, 0,
+                                         0, 0);
+  __m256i_u swapPairsVec = _mm256_setr_epi8(2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13, 2, 3, 0, 1, 6, 7, 4, 5,
+                                            10, 11, 8, 9, 14, 15, 12, 13);
+  __m256i_u singles[9];
+  int r, band;
+
+  for (;;) {
+    __m256i_u colSolved = zeroVec, changed = zeroVec, empty = zeroVec;
+
+    for (r = 0; r < 9; r++) {
+      singles[r] = _mm256_and_si256(
+          rows[r], _mm256_cmpeq_epi16(_mm256_and_si256(rows[r], _mm256_sub_epi16(rows[r], oneVec)), zeroVec));
+      colSolved = _mm256_or_si256(colSolved, singles[r]);
+    }
+
+    for (band = 0; band < 9; band += 3) {
+      __m256i_u boxSolved = or_box_lanes(
+          _mm256_or_si256(_mm256_or_si256(singles[band], singles[band + 1]), singles[band + 2]), swapPairsVec);
+
+      for (r = band; r < band + 3; r++) {
+        // a solved cell finds its own digit among the peers and keeps it
+        __m256i_u peers = _mm256_or_si256(_mm256_or_si256(or_row_lanes(singles[r], swapPairsVec), colSolved), boxSolved);
+        __m256i_u cell = _mm256_andnot_si256(_mm256_andnot_si256(singles[r], peers), rows[r]);
+        changed = _mm256_or_si256(changed, _mm256_xor_si256(cell, rows[r]));
+        empty = _mm256_or_si256(empty, _mm256_cmpeq_epi16(cell, zeroVec));
+        rows[r] = cell;
+      }
+    }
+
+    if (!_mm256_testz_si256(empty, validVec))
+      return 0;
+    if (!_mm256_testz_si256(changed, changed))
+      continue;
+
+    __m256i_u colOnce = zeroVec, colTwice = zeroVec;
+    for (r = 0; r < 9; r++)
+      combine_units(&colOnce, &colTwice, rows[r], zeroVec);
+    __m256i_u missing = _mm256_andnot_si256(colOnce, validVec);
+    __m256i_u colHidden = _mm256_andnot_si256(colTwice, colOnce);
+
+    for (band = 0; band < 9; band += 3) {
+      __m256i_u boxOnce = rows[band], boxTwice = zeroVec;
+      combine_units(&boxOnce, &boxTwice, rows[band + 1], zeroVec);
+      combine_units(&boxOnce, &boxTwice, rows[band + 2], zeroVec);
+      combine_box_lanes(&boxOnce, &boxTwice, swapPairsVec);
+      missing = _mm256_or_si256(missing, _mm256_andnot_si256(boxOnce, validVec));
+      __m256i_u boxHidden = _mm256_or_si256(_mm256_andnot_si256(boxTwice, boxOnce), colHidden);
+
+      for (r = band; r < band + 3; r++) {
+        __m256i_u rowOnce = rows[r], rowTwice = zeroVec;
+        combine_row_lanes(&rowOnce, &rowTwice, swapPairsVec);
+        missing = _mm256_or_si256(missing, _mm256_andnot_si256(rowOnce, validVec));
+
+        __m256i_u hidden = _mm256_and_si256(rows[r], _mm256_or_si256(_mm256_andnot_si256(rowTwice, rowOnce), boxHidden));
+        __m256i_u cell = _mm256_blendv_epi8(hidden, rows[r], _mm256_cmpeq_epi16(hidden, zeroVec));
+        changed = _mm256_or_si256(changed, _mm256_xor_si256(cell, rows[r]));
+        rows[r] = cell;
+      }
+    }
+
+    if (!_mm256_testz_si256(missing, missing))
+      return 0;
+    if (_mm256_testz_si256(changed, changed))
+      return 1;
+  }
+}
+
+// propagates, then guesses the candidates of a cell with the fewest left, a copy of the 9 vectors per guess
+static int search_cross_cells(__m256i_u *rows) {
+  if (!propagate_cross_cells(rows))
+    return 0;
+
+  uint16_t cells[9][16];
+  int r, lane, bestRow = -1, bestLane = 0, bestCount = 10;
+  for (r = 0; r < 9; r++) {
+    _mm256_storeu_si256((__m256i_u *)cells[r], rows[r]);
+    for (lane = 0; lane < 11; lane++) {
+      int count = _mm_popcnt_u32(cells[r][lane]);
+      if (count > 1 && count < bestCount) {
+        bestCount = count;
+        bestRow = r;
+        bestLane = lane;
+      }
+    }
+  }
+  if (bestRow < 0)
+    return 1;
+
+  for (uint32_t candidates = cells[bestRow][bestLane]; candidates; candidates = _blsr_u32(candidates)) {
+    __m256i_u guess[9];
+    memcpy(guess, rows, sizeof(guess));
+    cells[bestRow][bestLane] = (uint16_t)_blsi_u32(candidates);
+    guess[bestRow] = _mm256_loadu_si256((__m256i_u *)cells[bestRow]);
+
+    if (search_cross_cells(guess)) {
+      memcpy(rows, guess, sizeof(guess));
+      return 1;
+    }
+  }
+  return 0;
+}
+#pragma endregion
+
+#pragma region bit sliced engine
+// groups left to skip, and how many the next miss skips
+static __thread int bitsliceSkipped, bitsliceBackoff;
+
+static int try_bitsliced() {
+  if (!bitsliceSkipped)
+    return 1;
+  --bitsliceSkipped;
+  return 0;
+}
+
+// Naked and hidden singles for count puzzles of a batch at once, as boolean logic over bit sliced candidates. Groups of
+// 16 that end up solved are written straight away, a group with a puzzle left open, malformed or contradictory goes
+// through solve16sudokus, which solves or rejects it as usual. A solved group needs no validation: every cell holds one
+// candidate and no unit places a digit twice.
+static void solve_bitsliced(const batch_t *batch, int start, int count, uint16_t *data, solver_stats_t *stats) {
+  static __thread bitslice_t slices;
+  int stride = batch->stride, outputStride = batch->outputStride, groupCount = count >> 4;
+  uint8_t solved[16 * PACKED_BYTES_FOR_1_SUDOKUS];
+
+  uint64_t traceStart = trace_begin();
+  __m256i dead = transform_bitsliced(&batch->sudokus[start * stride], stride, groupCount, &slices);
+  __m256i open = propagate_bitsliced(&slices);
+  trace_end(TRACE_BITSLICE, traceStart);
+
+  uint16_t groupOpen[BITSLICE_LENGTH >> 4];
+  _mm256_storeu_si256((__m256i_u *)groupOpen, _mm256_or_si256(dead, open));
+  uint64_t solvedBlocks = stats->bitslicedBlocks;
+
+  for (int g = 0; g < groupCount; g++) {
+    int i = start + (g << 4);
+    const uint8_t *sudokus = &batch->sudokus[i * stride];
+    const uint8_t *solutions = batch->solutions ? &batch->solutions[i * stride] : NULL;
+    uint8_t *output = batch->output ? &batch->output[(size_t)i * outputStride] : NULL;
+
+    if (groupOpen[g]) {
+      solve16sudokus(sudokus, solutions, stride, output, outputStride, data, stats);
+      continue;
+    }
+
+    traceStart = trace_begin();
+    untransform_bitsliced(&slices, g, solved, PACKED_BYTES_FOR_1_SUDOKUS);
+    ++stats->blocks;
+    ++stats->bitslicedBlocks;
+#ifdef CHECK_SOLUTIONS
+    for (int j = 0; solutions && j < 16; j++) {
+      if (memcmp(&solved[j * PACKED_BYTES_FOR_1_SUDOKUS], &solutions[j * stride], SUDOKU_CELL_COUNT)) {
+        ++stats->failedBlocks;
+        break;
+      }
+    }
+#endif
+    for (int j = 0; output && j < 16; j++) {
+      uint8_t *record = &output[j * outputStride];
+      if (outputStride == BYTES_FOR_1_SUDOKUS && output != sudokus) {
+        memcpy(record, &sudokus[j * stride], SUDOKU_CELL_COUNT);
+        record[SUDOKU_CELL_COUNT] = ',';
+        record[BYTES_FOR_1_SUDOKUS - 1] = '\n';
+      }
+      if (outputStride == BYTES_FOR_1_SUDOKUS)
+        record += SUDOKU_CELL_COUNT + 1;
+      memcpy(record, &solved[j * PACKED_BYTES_FOR_1_SUDOKUS], SUDOKU_CELL_COUNT);
+    }
+    trace_end(TRACE_WRITE, traceStart);
+  }
+
+  if (stats->bitslicedBlocks == solvedBlocks) {
+    bitsliceBackoff = bitsliceBackoff ? (bitsliceBackoff << 1 > BITSLICE_MAX_SKIPPED ? BITSLICE_MAX_SKIPPED
+                                                                                     : bitsliceBackoff << 1)
+                                      : 1;
+    bitsliceSkipped = bitsliceBackoff;
+  } else {
+    bitsliceBackoff = 0;
+  }
+}
+
+// transposes groupCount groups of 16 puzzles with transpose16x16, a digit d + 1 and a blank set bit k of cand[c][d].
+// Returns the puzzles that are malformed or past count, which propagate_bitsliced starts out as dead.
+static __m256i transform_bitsliced(const uint8_t *sudokus, int stride, int groupCount, bitslice_t *slices) {
+  __m128i zeroCharVec = _mm_set1_epi8('0'), nineCharVec = _mm_set1_epi8('9');
+  uint16_t bad[BITSLICE_LENGTH >> 4];
+  __m128i rows[16];
+  int g, i, j, d;
+
+  memset(bad, 0xFF, sizeof(bad));
+  for (g = 0; g < groupCount; g++) {
+    const uint8_t *p_src = &sudokus[(g << 4) * stride];
+    uint32_t badChars = 0;
+
+    // the last round reads cells 80..95, which the input padding covers
+    for (i = 0; i < SUDOKU_CELL_COUNT; i += 16) {
+      for (j = 0; j < 16; j++)
+        rows[j] = _mm_loadu_si128((const __m128i_u *)&p_src[j * stride + i]);
+      transpose16x16(rows);
+
+      for (j = 0; j < 16 && i + j < SUDOKU_CELL_COUNT; j++) {
+        uint16_t *cand = (uint16_t *)slices->cand[i + j];
+        uint32_t blank = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(rows[j], zeroCharVec));
+        badChars |= (uint32_t)_mm_movemask_epi8(
+            _mm_or_si128(_mm_cmplt_epi8(rows[j], zeroCharVec), _mm_cmpgt_epi8(rows[j], nineCharVec)));
+
+        for (d = 0; d < 9; d++) {
+          __m128i digitVec = _mm_set1_epi8((char)('1' + d));
+          cand[(d << 4) + g] = (uint16_t)(blank | (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(rows[j], digitVec)));
+        }
+      }
+    }
+    bad[g] = (uint16_t)badChars;
+  }
+
+  // groups past count are never read, but are propagated along with the others
+  for (i = 0; g < (BITSLICE_LENGTH >> 4) && i < SUDOKU_CELL_COUNT; i++) {
+    for (d = 0; d < 9; d++) {
+      uint16_t *cand = (uint16_t *)&slices->cand[i][d];
+      memset(&cand[g], 0, ((BITSLICE_LENGTH >> 4) - g) * sizeof(uint16_t));
+    }
+  }
+  return _mm256_loadu_si256((const __m256i_u *)bad);
+}
+
+// Passes of naked and hidden singles over all puzzles until none of them changes or every one is solved or dead. A
+// puzzle is dead once a cell runs out of candidates, a unit places a digit twice or has no place left for one. Returns
+// the dead puzzles and those with a cell still open.
+static __m256i propagate_bitsliced(bitslice_t *slices) {
+  __m256i dead = _mm256_setzero_si256(), ones = _mm256_set1_epi32(-1);
+  int pass, c, d, u, j;
+
+  for (pass = 0;; pass++) {
+    __m256i open = _mm256_setzero_si256(), changed = _mm256_setzero_si256();
+
+    // naked singles: the cells with exactly one candidate
+    for (c = 0; c < SUDOKU_CELL_COUNT; c++) {
+      __m256i one = _mm256_setzero_si256(), two = _mm256_setzero_si256();
+      for (d = 0; d < 9; d++) {
+        two = _mm256_or_si256(two, _mm256_and_si256(one, slices->cand[c][d]));
+        one = _mm256_or_si256(one, slices->cand[c][d]);
+      }
+      slices->single[c] = _mm256_andnot_si256(two, one);
+      dead = _mm256_or_si256(dead, _mm256_xor_si256(one, ones));
+      open = _mm256_or_si256(open, _mm256_xor_si256(slices->single[c], ones));
+    }
+
+    // the digits each unit has placed, twice is a contradiction
+    for (u = 0; u < 27; u++) {
+      for (d = 0; d < 9; d++) {
+        __m256i one = _mm256_setzero_si256(), two = _mm256_setzero_si256();
+        for (j = 0; j < 9; j++) {
+          c = bitslice_unit_cell(u, j);
+          __m256i placed = _mm256_and_si256(slices->cand[c][d], slices->single[c]);
+          two = _mm256_or_si256(two, _mm256_and_si256(one, placed));
+          one = _mm256_or_si256(one, placed);
+        }
+        slices->units[u][d] = one;
+        dead = _mm256_or_si256(dead, two);
+      }
+    }
+
+    open = _mm256_andnot_si256(dead, open);
+    if (_mm256_testz_si256(open, open) || pass == BITSLICE_MAX_PASSES)
+      return _mm256_or_si256(dead, open);
+
+    // a digit placed in a unit leaves the other open cells of the unit
+    for (c = 0; c < SUDOKU_CELL_COUNT; c++) {
+      int r = c / 9, col = 9 + c % 9, b = 18 + (r / 3) * 3 + (c % 9) / 3;
+      for (d = 0; d < 9; d++) {
+        __m256i placed = _mm256_or_si256(_mm256_or_si256(slices->units[r][d], slices->units[col][d]),
+                                         slices->units[b][d]);
+        __m256i cand = _mm256_and_si256(slices->cand[c][d], _mm256_or_si256(slices->single[c],
+                                                                             _mm256_xor_si256(placed, ones)));
+        changed = _mm256_or_si256(changed, _mm256_xor_si256(cand, slices->cand[c][d]));
+        slices->cand[c][d] = cand;
+      }
+    }
+
+    // hidden singles: the digits with exactly one place left in a unit
+    for (u = 0; u < 27; u++) {
+      for (d = 0; d < 9; d++) {
+        __m256i one = _mm256_setzero_si256(), two = _mm256_setzero_si256();
+        for (j = 0; j < 9; j++) {
+          c = bitslice_unit_cell(u, j);
+          two = _mm256_or_si256(two, _mm256_and_si256(one, slices->cand[c][d]));
+          one = _mm256_or_si256(one, slices->cand[c][d]);
+        }
+        slices->units[u][d] = _mm256_andnot_si256(two, one);
+        dead = _mm256_or_si256(dead, _mm256_xor_si256(one, ones));
+      }
+    }
+
+    for (c = 0; c < SUDOKU_CELL_COUNT; c++) {
+      int r = c / 9, col = 9 + c % 9, b = 18 + (r / 3) * 3 + (c % 9) / 3;
+      __m256i hidden[9], any = _mm256_setzero_si256();
+      for (d = 0; d < 9; d++) {
+        hidden[d] = _mm256_or_si256(_mm256_or_si256(slices->units[r][d], slices->units[col][d]), slices->units[b][d]);
+        hidden[d] = _mm256_and_si256(hidden[d], slices->cand[c][d]);
+        any = _mm256_or_si256(any, hidden[d]);
+      }
+      for (d = 0; d < 9; d++) {
+        __m256i cand = _mm256_or_si256(_mm256_andnot_si256(any, slices->cand[c][d]), hidden[d]);
+        changed = _mm256_or_si256(changed, _mm256_xor_si256(cand, slices->cand[c][d]));
+        slices->cand[c][d] = cand;
+      }
+    }
+
+    if (_mm256_testz_si256(changed, changed))
+      return _mm256_or_si256(dead, open);
+  }
+}
+
+// cell j of row, column or box u, the units are numbered like the r, 9 + c and 18 + b of the passes
+static inline int bitslice_unit_cell(int u, int j) {
+  if (u < 9)
+    return u * 9 + j;
+  if (u < 18)
+    return j * 9 + u - 9;
+  u -= 18;
+  return ((u / 3) * 3 + j / 3) * 9 + (u % 3) * 3 + j % 3;
+}
+
+// writes the 81 digits of each puzzle of a solved group at stride, from the four bits of every cell's digit
+static void untransform_bitsliced(const bitslice_t *slices, int group, uint8_t *dest, int stride) {
+  __m128i rows[16];
+  int i, j;
+
+  for (i = 0; i < SUDOKU_CELL_COUNT; i += 16) {
+    for (j = 0; j < 16; j++) {
+      if (i + j >= SUDOKU_CELL_COUNT) {
+        rows[j] = _mm_setzero_si128();
+        continue;
+      }
+      const uint16_t *cand = (const uint16_t *)slices->cand[i + j];
+      uint32_t digit[9];
+      for (int d = 0; d < 9; d++)
+        digit[d] = cand[(d << 4) + group];
+
+      __m128i bit0 = lane_bits_to_bytes(digit[0] | digit[2] | digit[4] | digit[6] | digit[8]);
+      __m128i bit1 = lane_bits_to_bytes(digit[1] | digit[2] | digit[5] | digit[6]);
+      __m128i bit2 = lane_bits_to_bytes(digit[3] | digit[4] | digit[5] | digit[6]);
+      __m128i bit3 = lane_bits_to_bytes(digit[7] | digit[8]);
+      rows[j] = _mm_or_si128(_mm_or_si128(_mm_and_si128(bit0, _mm_set1_epi8(1)), _mm_and_si128(bit1, _mm_set1_epi8(2))),
+                             _mm_or_si128(_mm_and_si128(bit2, _mm_set1_epi8(4)), _mm_and_si128(bit3, _mm_set1_epi8(8))));
+      rows[j] = _mm_or_si128(rows[j], _mm_set1_epi8('0'));
+    }
+
+    transpose16x16(rows);
+
+    for (j = 0; j < 16; j++)
+      _mm_storeu_si128((__m128i_u *)&dest[j * stride + i], rows[j]);
+  }
+}
+
+// byte k is 0xFF where bit k of the 16 bit mask is set
+static inline __m128i lane_bits_to_bytes(uint32_t mask) {
+  __m128i bitVec = _mm_setr_epi8(1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128);
+  __m128i bytes = _mm_shuffle_epi8(_mm_cvtsi32_si128((int)mask), _mm_setr_epi8(0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 1, 1,
+                                                                                1, 1));
+  return _mm_cmpeq_epi8(_mm_and_si128(bytes, bitVec), bitVec);
+}
+#pragma endregion
+
+#pragma region shards
+// Splits the input file into byte ranges and solves every range in its own process, this binary started with --range.
+// The shard outputs and stats are merged in input order. A shard whose process fails is reported and its records are
+// written unsolved, so a crash costs that range only and the output still lines up with the input. Returns the number
+// of failed shards.
+static int run_sharded(const char *self, const char *inputPath, const char *outputPath, int shardCount,
+                       int threadCount, int numa, const budget_t *budget, const char *variantSpec,
+                       solver_stats_t *stats) {
+  FILE *fp = fopen(inputPath, "rb");
+  if (!fp) {
+    printf("Could not read %s\n", inputPath);
+    return shardCount;
+  }
+
+  long bounds[MAX_SHARD_COUNT + 1];
+  fseek(fp, 0, SEEK_END);
+  shard_bounds(fp, ftell(fp), shardCount, bounds);
+  fclose(fp);
+
+  const char *prefix = outputPath ? outputPath : inputPath;
+  char startArgs[MAX_SHARD_COUNT][24], endArgs[MAX_SHARD_COUNT][24], threadArg[16], budgetArg[24], deadlineArg[32];
+  char outputPaths[MAX_SHARD_COUNT][1024], statsPaths[MAX_SHARD_COUNT][1024];
+  intptr_t processes[MAX_SHARD_COUNT];
+  int i, failedShards = 0;
+
+  snprintf(threadArg, sizeof(threadArg), "%d", threadCount);
+  snprintf(budgetArg, sizeof(budgetArg), "%llu", (unsigned long long)budget->nodes);
+  snprintf(deadlineArg, sizeof(deadlineArg), "%.3f", budget->deadlineMs * 1000);
+
+  for (i = 0; i < shardCount; i++) {
+    snprintf(startArgs[i], sizeof(startArgs[i]), "%ld", bounds[i]);
+    snprintf(endArgs[i], sizeof(endArgs[i]), "%ld", bounds[i + 1]);
+    snprintf(outputPaths[i], sizeof(outputPaths[i]), "%s.shard%d", prefix, i);
+    snprintf(statsPaths[i], sizeof(statsPaths[i]), "%s.shard%d.stats", prefix, i);
+
+    char *args[22];
+    int argCount = 0;
+    args[argCount++] = (char *)self;
+    args[argCount++] = (char *)"--quiet";
+    args[argCount++] = (char *)"--threads";
+    args[argCount++] = threadArg;
+    args[argCount++] = (char *)"--range";
+    args[argCount++] = startArgs[i];
+    args[argCount++] = endArgs[i];
+    args[argCount++] = (char *)"--stats-bin";
+    args[argCount++] = statsPaths[i];
+    if (outputPath) {
+      args[argCount++] = (char *)"--output";
+      args[argCount++] = outputPaths[i];
+    }
+    if (numa)
+      args[argCount++] = (char *)"--numa";
+    if (budget->nodes) {
+      args[argCount++] = (char *)"--budget";
+      args[argCount++] = budgetArg;
+    }
+    if (budget->deadlineMs > 0) {
+      args[argCount++] = (char *)"--deadline-us";
+      args[argCount++] = deadlineArg;
+    }
+    if (variantSpec) {
+      args[argCount++] = (char *)"--variant";
+      args[argCount++] = (char *)variantSpec;
+    }
+    args[argCount++] = (char *)inputPath;
+    args[argCount] = NULL;
+
+    remove(statsPaths[i]);
+    processes[i] = spawn_process(args);
+  }
+
+  FILE *output = outputPath ? fopen(outputPath, "wb") : NULL;
+  if (outputPath && !output)
+    printf("Could not write %s\n", outputPath);
+
+  for (i = 0; i < shardCount; i++) {
+    int failed = processes[i] < 0 || wait_process(processes[i]) != 0;
+
+    solver_stats_t shardStats;
+    FILE *statsFile = failed ? NULL : fopen(statsPaths[i], "rb");
+    failed |= !statsFile || fread(&shardStats, sizeof(shardStats), 1, statsFile) != 1;
+    if (statsFile)
+      fclose(statsFile);
+
+    if (!failed && output)
+      failed = append_file(output, outputPaths[i]) != 0;
+
+    if (failed) {
+      printf("Shard %d (bytes %ld to %ld) failed\n", i, bounds[i], bounds[i + 1]);
+      ++failedShards;
+      if (output && append_unsolved(output, inputPath, bounds[i], bounds[i + 1]))
+        printf("Could not write the records of shard %d to %s\n", i, outputPath);
+    } else {
+      merge_stats(stats, &shardStats);
+    }
+
+    remove(statsPaths[i]);
+    if (outputPath)
+      remove(outputPaths[i]);
+  }
+
+  if (output)
+    fclose(output);
+  return failedShards;
+}
+
+// writes the records of a failed shard with a solution of '0's, like any other puzzle without a solution
+static int append_unsolved(FILE *dest, const char *inputPath, long start, long end) {
+  size_t length;
+  uint8_t *bytes = read_input(inputPath, start, end, &length);
+  if (!bytes)
+    return -1;
+
+  batch_t batch;
+  int count = load_batch(bytes, length, start == 0, &batch), result = 0;
+  uint8_t record[BYTES_FOR_1_SUDOKUS];
+  record[SUDOKU_CELL_COUNT] = ',';
+  memset(&record[SUDOKU_CELL_COUNT + 1], '0', SUDOKU_CELL_COUNT);
+  record[BYTES_FOR_1_SUDOKUS - 1] = '\n';
+  for (int i = 0; i < count; i++) {
+    memcpy(record, &batch.sudokus[(size_t)i * batch.stride], SUDOKU_CELL_COUNT);
+    if (fwrite(record, 1, BYTES_FOR_1_SUDOKUS, dest) != BYTES_FOR_1_SUDOKUS)
+      result = -1;
+  }
+
+  if (batch.stride != BYTES_FOR_1_SUDOKUS) {
+    _mm_free((void *)batch.sudokus);
+    if (batch.solutions)
+      _mm_free((void *)batch.solutions);
+  }
+  free(bytes);
+  return result;
+}
+
+// Kaggle files are cut on block boundaries of the 164 byte stride, anything else just after a newline. bounds gets
+// shardCount + 1 offsets, a shard can be empty.
+static void shard_bounds(FILE *fp, long length, int shardCount, long *bounds) {
+  uint8_t head[4096];
+  fseek(fp, 0, SEEK_SET);
+  size_t headLength = fread(head, 1, sizeof(head), fp);
+  long start = 0;
+
+  if (headLength && !(head[0] >= '0' && head[0] <= '9') && head[0] != '.') {
+    const uint8_t *newline = (const uint8_t *)memchr(head, '\n', headLength);
+    start = newline ? (long)(newline - head) + 1 : length;
+  }
+
+  int kaggleLayout = start + BYTES_FOR_1_SUDOKUS <= (long)headLength && (length - start) % BYTES_FOR_1_SUDOKUS == 0 &&
+                     head[start + SUDOKU_CELL_COUNT] == ',' && head[start + BYTES_FOR_1_SUDOKUS - 1] == '\n';
+  long blockBytes = 16 * BYTES_FOR_1_SUDOKUS;
+  long blockCount = (length - start + blockBytes - 1) / blockBytes;
+
+  bounds[0] = 0;
+  bounds[shardCount] = length;
+
+  for (int i = 1; i < shardCount; i++) {
+    long bound;
+    if (kaggleLayout) {
+      bound = start + blockCount * i / shardCount * blockBytes;
+    } else {
+      // the first newline at or after the even split, the byte before the split may already end a line
+      bound = length / shardCount * i;
+      if (bound > start) {
+        fseek(fp, bound - 1, SEEK_SET);
+        int c;
+        while ((c = fgetc(fp)) != EOF && c != '\n')
+          ++bound;
+        if (c == EOF)
+          bound = length;
+      }
+    }
+
+    bound = bound < start ? start : bound > length ? length : bound;
+    bounds[i] = bound < bounds[i - 1] ? bounds[i - 1] : bound;
+  }
+}
+
+#ifdef _WIN32
+static intptr_t spawn_process(char **args) { return _spawnv(_P_NOWAIT, args[0], args); }
+
+static int wait_process(intptr_t process) {
+  int status;
+  return _cwait(&status, process, 0) < 0 ? -1 : status;
+}
+#else
+static intptr_t spawn_process(char **args) {
+  pid_t pid;
+  return posix_spawnp(&pid, args[0], NULL, NULL, args, environ) ? -1 : (intptr_t)pid;
+}
+
+// anything but a clean exit with status 0 counts as a failure, a crash included
+static int wait_process(intptr_t process) {
+  int status;
+  if (waitpid((pid_t)process, &status, 0) < 0)
+    return -1;
+  return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+#endif
+
+static int append_file(FILE *dest, const char *path) {
+  static uint8_t buffer[1 << 20];
+  FILE *fp = fopen(path, "rb");
+  if (!fp)
+    return -1;
+
+  size_t length;
+  int result = 0;
+  while ((length = fread(buffer, 1, sizeof(buffer), fp)) != 0)
+    if (fwrite(buffer, 1, length, dest) != length)
+      result = -1;
+
+  fclose(fp);
+  return result;
+}
+#pragma endregion
+
+#pragma region checkpoint
+// Solves the batch in segments of segmentBlocks blocks. Each segment's records are appended to the output and synced
+// before the checkpoint moves past it, so a checkpoint never covers output that is not on disk. With resume the puzzles
+// the checkpoint covers are skipped, its stats carried over and the output cut back to the length it recorded, which
+// drops whatever a killed run wrote after its last checkpoint. Returns 0, or 1 after printing what went wrong.
+static int run_checkpointed(const batch_t *batch, int sudokuCount, size_t inputLength, const char *outputPath,
+                            const char *checkpointPath, int segmentBlocks, int resume, int threadCount, int numa,
+                            solver_stats_t *stats) {
+  checkpoint_t checkpoint = {{'S', 'U', 'D', 'O', 'K', 'U', 'C', '1'}, sizeof(solver_stats_t), inputLength,
+                             sudokuCount, 0, 0, {0}};
+
+  if (resume) {
+    if (read_checkpoint(checkpointPath, &checkpoint)) {
+      printf("Could not read checkpoint %s\n", checkpointPath);
+      return 1;
+    }
+    if (checkpoint.inputLength != inputLength || checkpoint.puzzleCount != sudokuCount) {
+      printf("Checkpoint %s is for another input\n", checkpointPath);
+      return 1;
+    }
+    if (outputPath && truncate_file(outputPath, checkpoint.outputOffset)) {
+      printf("Could not cut %s back to %llu bytes\n", outputPath, (unsigned long long)checkpoint.outputOffset);
+      return 1;
+    }
+    *stats = checkpoint.stats;
+    printf("Resuming at puzzle %lld of %d\n", (long long)checkpoint.doneCount, sudokuCount);
+  }
+
+  FILE *fp = NULL;
+  if (outputPath && !(fp = fopen(outputPath, resume ? "ab" : "wb"))) {
+    printf("Could not write %s\n", outputPath);
+    return 1;
+  }
+
+  int segmentLength = segmentBlocks > batch->count >> 4 ? batch->count : segmentBlocks << 4;
+  uint16_t *arena = threadCount == 1 && !numa ? alloc_block_arena(INTERLEAVED_BLOCKS, -1) : NULL;
+  batch_t segment = *batch;
+  segment.output = fp ? (uint8_t *)_mm_malloc((size_t)segmentLength * BYTES_FOR_1_SUDOKUS, 64) : NULL;
+  int failed = 0;
+
+  for (int done = (int)checkpoint.doneCount; done < sudokuCount && !failed; done += segment.count) {
+    segment.count = batch->count - done < segmentLength ? batch->count - done : segmentLength;
+    segment.padding = done + segment.count == batch->count ? batch->padding : 0;
+    segment.sudokus = &batch->sudokus[(size_t)done * batch->stride];
+    if (batch->solutions)
+      segment.solutions = &batch->solutions[(size_t)done * batch->stride];
+
+    if (arena)
+      run(&segment, arena, stats);
+    else
+      run_threaded(&segment, threadCount, numa, stats);
+
+    int written = sudokuCount - done < segment.count ? sudokuCount - done : segment.count;
+    size_t outputBytes = (size_t)written * BYTES_FOR_1_SUDOKUS;
+    if (fp && (fwrite(segment.output, 1, outputBytes, fp) != outputBytes || sync_file(fp))) {
+      printf("Could not write %s\n", outputPath);
+      failed = 1;
+      break;
+    }
+
+    checkpoint.doneCount = done + written;
+    checkpoint.outputOffset += fp ? outputBytes : 0;
+    checkpoint.stats = *stats;
+    if (write_checkpoint(checkpointPath, &checkpoint)) {
+      printf("Could not write checkpoint %s\n", checkpointPath);
+      failed = 1;
+    }
+  }
+
+  if (arena)
+    free_block_arena(arena, INTERLEAVED_BLOCKS, -1);
+  if (segment.output)
+    _mm_free(segment.output);
+  if (fp)
+    fclose(fp);
+  return failed;
+}
+
+static int read_checkpoint(const char *path, checkpoint_t *checkpoint) {
+  checkpoint_t stored;
+  FILE *fp = fopen(path, "rb");
+  if (!fp)
+    return -1;
+  int result = fread(&stored, sizeof(stored), 1, fp) == 1 ? 0 : -1;
+  fclose(fp);
+
+  if (result || memcmp(stored.magic, checkpoint->magic, sizeof(stored.magic)) || stored.statsSize != checkpoint->statsSize)
+    return -1;
+  *checkpoint = stored;
+  return 0;
+}
+
+// writes a temporary file next to the checkpoint and renames it over, so a kill leaves the old or the new checkpoint
+static int write_checkpoint(const char *path, const checkpoint_t *checkpoint) {
+  char tmpPath[4096];
+  snprintf(tmpPath, sizeof(tmpPath), "%s.tmp", path);
+
+  FILE *fp = fopen(tmpPath, "wb");
+  if (!fp)
+    return -1;
+  int result = fwrite(checkpoint, sizeof(*checkpoint), 1, fp) == 1 && !sync_file(fp) ? 0 : -1;
+  fclose(fp);
+
+#ifdef _WIN32
+  remove(path);
+#endif
+  return result || rename(tmpPath, path) ? -1 : 0;
+}
+
+static int sync_file(FILE *fp) {
+  if (fflush(fp))
+    return -1;
+#ifdef _WIN32
+  return _commit(_fileno(fp));
+#else
+  return fsync(fileno(fp));
+#endif
+}
+
+// fails instead of growing a file that is shorter than length
+static int truncate_file(const char *path, uint64_t length) {
+#ifdef _WIN32
+  int fd = _open(path, _O_RDWR | _O_BINARY);
+  if (fd < 0)
+    return -1;
+  int result = (uint64_t)_filelengthi64(fd) < length ? -1 : _chsize_s(fd, (__int64)length);
+  _close(fd);
+  return result;
+#else
+  struct stat info;
+  if (stat(path, &info) || (uint64_t)info.st_size < length)
+    return -1;
+  return truncate(path, (off_t)length);
+#endif
+}
+#pragma endregion
+
+#pragma region fill in place
+// Maps a kaggle layout file read-write and solves it in place: every block is untransformed straight into the solution
+// slots after the commas, so the records are neither buffered nor serialized. With outputPath the input is copied there
+// first and the copy is filled. A mapping has no room to pad, so the last count % 16 records go through a padded block
+// of their own. Returns the number of sudokus, or -1 after printing what went wrong.
+static int run_filling(const char *inputPath, const char *outputPath, const budget_t *budget, int threadCount, int numa,
+                       solver_stats_t *stats) {
+#ifdef _WIN32
+  (void)inputPath, (void)outputPath, (void)budget, (void)threadCount, (void)numa, (void)stats;
+  printf("--fill needs mmap\n");
+  return -1;
+#else
+  // copying a file onto itself would truncate it before it is read
+  struct stat info, outputInfo;
+  if (outputPath && (!strcmp(inputPath, outputPath) || (!stat(inputPath, &info) && !stat(outputPath, &outputInfo) &&
+                                                        info.st_dev == outputInfo.st_dev &&
+                                                        info.st_ino == outputInfo.st_ino))) {
+    printf("--output is the input itself, leave it out to fill %s in place\n", inputPath);
+    return -1;
+  }
+
+  const char *path = outputPath ? outputPath : inputPath;
+  if (outputPath && copy_file(inputPath, outputPath)) {
+    printf("Could not copy %s to %s\n", inputPath, outputPath);
+    return -1;
+  }
+
+  int fd = open(path, O_RDWR);
+  if (fd < 0 || fstat(fd, &info)) {
+    printf("Could not open %s\n", path);
+    if (fd >= 0)
+      close(fd);
+    return -1;
+  }
+  size_t length = (size_t)info.st_size, start;
+  uint8_t *bytes = length ? (uint8_t *)mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : NULL;
+  close(fd);
+  if (bytes == MAP_FAILED) {
+    printf("Could not map %s\n", path);
+    return -1;
+  }
+  if (!bytes || !kaggle_layout(bytes, length, 1, &start)) {
+    printf("--fill needs an input in the kaggle layout\n");
+    if (bytes)
+      munmap(bytes, length);
+    return -1;
+  }
+  madvise(bytes, length, MADV_SEQUENTIAL);
+
+  // an output that is the input itself only gets the solutions written
+  uint8_t *records = bytes + start;
+  size_t count = (length - start) / BYTES_FOR_1_SUDOKUS, direct = count & ~(size_t)15;
+  batch_t batch = {records, NULL, records, (int)direct, BYTES_FOR_1_SUDOKUS, BYTES_FOR_1_SUDOKUS, *budget};
+  if (threadCount == 1 && !numa) {
+    uint16_t *arena = alloc_block_arena(INTERLEAVED_BLOCKS, -1);
+    run(&batch, arena, stats);
+    free_block_arena(arena, INTERLEAVED_BLOCKS, -1);
+  } else if (direct) {
+    run_threaded(&batch, threadCount, numa, stats);
+  }
+
+  if (count > direct) {
+    uint8_t tail[16 * BYTES_FOR_1_SUDOKUS + INPUT_PADDING];
+    size_t tailBytes = (count - direct) * BYTES_FOR_1_SUDOKUS;
+    memcpy(tail, &records[direct * BYTES_FOR_1_SUDOKUS], tailBytes);
+    pad_batch(tail, NULL, (int)(count - direct), BYTES_FOR_1_SUDOKUS, 1);
+    batch.sudokus = batch.output = tail;
+    batch.count = 16;
+    batch.padding = 16 - (int)(count - direct);
+
+    uint16_t *arena = alloc_block_arena(INTERLEAVED_BLOCKS, -1);
+    run(&batch, arena, stats);
+    free_block_arena(arena, INTERLEAVED_BLOCKS, -1);
+    memcpy(&records[direct * BYTES_FOR_1_SUDOKUS], tail, tailBytes);
+  }
+
+  munmap(bytes, length);
+  return (int)count;
+#endif
+}
+
+// copy_file_range lets a file system that can share extents copy without moving the bytes, elsewhere it is a plain copy
+static int copy_file(const char *src, const char *dest) {
+#ifdef __linux__
+  struct stat info;
+  int in = open(src, O_RDONLY), out = open(dest, O_WRONLY | O_CREAT | O_TRUNC, 0644), result = -1;
+  if (in >= 0 && out >= 0 && !fstat(in, &info)) {
+    off_t left = info.st_size;
+    ssize_t copied = 0;
+    while (left > 0 && (copied = copy_file_range(in, NULL, out, NULL, (size_t)left, 0)) > 0)
+      left -= copied;
+    result = left ? -1 : 0;
+  }
+  if (in >= 0)
+    close(in);
+  if (out >= 0 && close(out))
+    result = -1;
+  if (!result)
+    return 0;
+#endif
+  FILE *fp = fopen(dest, "wb");
+  int failed = fp ? append_file(fp, src) : -1;
+  if (fp && fclose(fp))
+    failed = -1;
+  return failed;
+}
+#pragma endregion
+
+#pragma region service
+// Clients send puzzle lines (the same formats the batch input takes) and get a kaggle layout line back for each one, in
+// order. A "stats" line answers with a json line of the block fill and wait/latency histograms. Puzzles from all
+// connections share one queue; a worker takes a full block as soon as 16 are waiting, or whatever is there once the
+// oldest has waited maxWaitMs, so a longer wait trades latency for fuller blocks.
+typedef struct {
+  int remaining;
+} service_group_t;
+
+typedef struct {
+  const uint8_t *record;
+  uint8_t *reply;
+  service_group_t *group;
+  double queuedMs;
+} service_puzzle_t;
+
+typedef struct {
+  pthread_mutex_t lock;
+  pthread_cond_t queued, dequeued, solved;
+  service_puzzle_t queue[SERVICE_QUEUE_LENGTH];
+  int head, count;
+  double maxWaitMs;
+  solver_stats_t stats;
+  // blocks by lanes filled, time from queued to taken by a worker, time from queued to solved
+  uint64_t fill[17], waitUs[SERVICE_LATENCY_BUCKET_COUNT], latencyUs[SERVICE_LATENCY_BUCKET_COUNT];
+} service_t;
+
+static service_t service = {PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER, PTHREAD_COND_INITIALIZER,
+                            PTHREAD_COND_INITIALIZER};
+
+#ifndef _WIN32
+static inline int latency_bucket(double ms) {
+  uint32_t us = (uint32_t)(ms * 1000);
+  int bucket = us ? 32 - (int)_lzcnt_u32(us) : 0;
+  return bucket < SERVICE_LATENCY_BUCKET_COUNT ? bucket : SERVICE_LATENCY_BUCKET_COUNT - 1;
+}
+
+// address is a port on 127.0.0.1 if it is all digits, a unix domain socket path otherwise
+static int run_service(const char *address, int threadCount, double maxWaitMs) {
+  int port = (int)strspn(address, "0123456789") == (int)strlen(address) ? atoi(address) : -1;
+  int listener = socket(port >= 0 ? AF_INET : AF_UNIX, SOCK_STREAM, 0);
+  int bound;
+
+  if (port >= 0) {
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((uint16_t)port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    int reuse = 1;
+    setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    bound = bind(listener, (struct sockaddr *)&addr, sizeof(addr));
+  } else {
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, address, sizeof(addr.sun_path) - 1);
+    unlink(address);
+    bound = bind(listener, (struct sockaddr *)&addr, sizeof(addr));
+  }
+
+  if (listener < 0 || bound < 0 || listen(listener, 64) < 0) {
+    printf("Could not listen on %s\n", address);
+    return 1;
+  }
+
+  service.maxWaitMs = maxWaitMs;
+  for (int i = 0; i < threadCount; i++) {
+    pthread_t thread;
+    pthread_create(&thread, NULL, service_worker, NULL);
+    pthread_detach(thread);
+  }
+
+  printf("Serving on %s with %d workers, max wait %.0fus\n", address, threadCount, maxWaitMs * 1000);
+  fflush(stdout);
+
+  for (;;) {
+    int connection = accept(listener, NULL, NULL);
+    if (connection < 0)
+      continue;
+
+    pthread_t thread;
+    pthread_create(&thread, NULL, service_connection, (void *)(intptr_t)connection);
+    pthread_detach(thread);
+  }
+}
+
+static void *service_worker(void *arg) {
+  (void)arg;
+  uint8_t *sudokus = (uint8_t *)_mm_malloc(16 * PACKED_BYTES_FOR_1_SUDOKUS + INPUT_PADDING, 64);
+  uint16_t *data = alloc_block_arena(1, -1);
+  uint8_t output[16 * BYTES_FOR_1_SUDOKUS];
+  service_puzzle_t taken[16];
+  solver_stats_t stats;
+  int i;
+
+  pthread_mutex_lock(&service.lock);
+  for (;;) {
+    if (service.count < 16) {
+      if (!service.count) {
+        pthread_cond_wait(&service.queued, &service.lock);
+        continue;
+      }
+
+      double deadline = service.queue[service.head].queuedMs + service.maxWaitMs;
+      if (wall_ms() < deadline) {
+        struct timespec ts;
+        ts.tv_sec = (time_t)(deadline / 1000);
+        ts.tv_nsec = (long)((deadline - (double)ts.tv_sec * 1000) * 1000000);
+        pthread_cond_timedwait(&service.queued, &service.lock, &ts);
+        continue;
+      }
+    }
+
+    int count = service.count < 16 ? service.count : 16;
+    for (i = 0; i < count; i++)
+      taken[i] = service.queue[(service.head + i) % SERVICE_QUEUE_LENGTH];
+    service.head = (service.head + count) % SERVICE_QUEUE_LENGTH;
+    service.count -= count;
+    pthread_cond_broadcast(&service.dequeued);
+    double takenMs = wall_ms();
+    pthread_mutex_unlock(&service.lock);
+
+    for (i = 0; i < count; i++)
+      memcpy(&sudokus[i * PACKED_BYTES_FOR_1_SUDOKUS], taken[i].record, PACKED_BYTES_FOR_1_SUDOKUS);
+
+    memset(&stats, 0, sizeof(stats));
+    solve_block(sudokus, PACKED_BYTES_FOR_1_SUDOKUS, count, output, data, &stats);
+    double solvedMs = wall_ms();
+
+    pthread_mutex_lock(&service.lock);
+    merge_stats(&service.stats, &stats);
+    ++service.fill[count];
+    for (i = 0; i < count; i++) {
+      memcpy(taken[i].reply, &output[i * BYTES_FOR_1_SUDOKUS], BYTES_FOR_1_SUDOKUS);
+      ++service.waitUs[latency_bucket(takenMs - taken[i].queuedMs)];
+      ++service.latencyUs[latency_bucket(solvedMs - taken[i].queuedMs)];
+      --taken[i].group->remaining;
+    }
+    pthread_cond_broadcast(&service.solved);
+  }
+}
+
+// reads lines until the client hangs up, the replies to the lines of one read go out together
+static void *service_connection(void *arg) {
+  int fd = (int)(intptr_t)arg;
+  // normalize_cells reads 96 bytes from the start of a line
+  uint8_t *buffer = (uint8_t *)malloc(SERVICE_READ_BYTES + PACKED_BYTES_FOR_1_SUDOKUS);
+  uint8_t *records = (uint8_t *)_mm_malloc(SERVICE_GROUP_LENGTH * PACKED_BYTES_FOR_1_SUDOKUS, 64);
+  uint8_t *solutions = (uint8_t *)_mm_malloc(SERVICE_GROUP_LENGTH * PACKED_BYTES_FOR_1_SUDOKUS, 64);
+  uint8_t *replies = (uint8_t *)malloc(SERVICE_GROUP_LENGTH * BYTES_FOR_1_SUDOKUS);
+  size_t filled = 0, solutionCount;
+  int count = 0, open = 1;
+
+  while (open) {
+    ssize_t length = read(fd, &buffer[filled], SERVICE_READ_BYTES - filled);
+    if (length <= 0)
+      break;
+    filled += (size_t)length;
+
+    size_t lineStart = 0;
+    const uint8_t *newline;
+    while (open && (newline = (const uint8_t *)memchr(&buffer[lineStart], '\n', filled - lineStart))) {
+      size_t lineLength = (size_t)(newline - &buffer[lineStart]);
+      const char *line = (const char *)&buffer[lineStart];
+
+      if (!strncmp(line, "stats", 5) && (lineLength == 5 || (lineLength == 6 && line[5] == '\r'))) {
+        char text[2048];
+        solve_service_group(records, replies, count);
+        open = write_all(fd, replies, (size_t)count * BYTES_FOR_1_SUDOKUS) == 0 &&
+               write_all(fd, text, (size_t)format_service_stats(text, sizeof(text))) == 0;
+        count = 0;
+      } else {
+        count += parse_line(&buffer[lineStart], lineLength, &records[count * PACKED_BYTES_FOR_1_SUDOKUS],
+                            &solutions[count * PACKED_BYTES_FOR_1_SUDOKUS], &solutionCount);
+      }
+
+      if (count == SERVICE_GROUP_LENGTH) {
+        solve_service_group(records, replies, count);
+        open = write_all(fd, replies, (size_t)count * BYTES_FOR_1_SUDOKUS) == 0;
+        count = 0;
+      }
+      lineStart += lineLength + 1;
+    }
+
+    if (count) {
+      solve_service_group(records, replies, count);
+      open &= write_all(fd, replies, (size_t)count * BYTES_FOR_1_SUDOKUS) == 0;
+      count = 0;
+    }
+
+    // a line that does not fit the buffer is dropped
+    filled -= lineStart;
+    memmove(buffer, &buffer[lineStart], filled);
+    if (filled == SERVICE_READ_BYTES)
+      filled = 0;
+  }
+
+  close(fd);
+  free(buffer);
+  _mm_free(records);
+  _mm_free(solutions);
+  free(replies);
+  return NULL;
+}
+
+// queues the records and waits until the workers have written all replies
+static void solve_service_group(const uint8_t *records, uint8_t *replies, int count) {
+  service_group_t group = {count};
+  _mm_sfence();
+
+  pthread_mutex_lock(&service.lock);
+  for (int i = 0; i < count; i++) {
+    while (service.count == SERVICE_QUEUE_LENGTH)
+      pthread_cond_wait(&service.dequeued, &service.lock);
+
+    service_puzzle_t *puzzle = &service.queue[(service.head + service.count++) % SERVICE_QUEUE_LENGTH];
+    puzzle->record = &records[i * PACKED_BYTES_FOR_1_SUDOKUS];
+    puzzle->reply = &replies[i * BYTES_FOR_1_SUDOKUS];
+    puzzle->group = &group;
+    puzzle->queuedMs = wall_ms();
+    pthread_cond_broadcast(&service.queued);
+  }
+
+  while (group.remaining)
+    pthread_cond_wait(&service.solved, &service.lock);
+  pthread_mutex_unlock(&service.lock);
+}
+
+static int format_service_stats(char *text, size_t size) {
+  int length, i;
+  uint64_t blocks = 0, lanes = 0;
+
+  pthread_mutex_lock(&service.lock);
+  for (i = 1; i <= 16; i++) {
+    blocks += service.fill[i];
+    lanes += service.fill[i] * i;
+  }
+
+  length = snprintf(text, size, "{\"blocks\": %llu, \"puzzles\": %llu, \"average_fill\": %.2f, \"max_wait_us\": %.0f",
+                    (unsigned long long)blocks, (unsigned long long)lanes, blocks ? (double)lanes / blocks : 0.0,
+                    service.maxWaitMs * 1000);
+  length += snprintf(&text[length], size - length, ", \"fill\": [");
+  for (i = 1; i <= 16; i++)
+    length += snprintf(&text[length], size - length, i > 1 ? ", %llu" : "%llu", (unsigned long long)service.fill[i]);
+  // bucket i counts times below 2^i us
+  length += snprintf(&text[length], size - length, "], \"wait_us_log2\": [");
+  for (i = 0; i < SERVICE_LATENCY_BUCKET_COUNT; i++)
+    length += snprintf(&text[length], size - length, i ? ", %llu" : "%llu", (unsigned long long)service.waitUs[i]);
+  length += snprintf(&text[length], size - length, "], \"latency_us_log2\": [");
+  for (i = 0; i < SERVICE_LATENCY_BUCKET_COUNT; i++)
+    length += snprintf(&text[length], size - length, i ? ", %llu" : "%llu", (unsigned long long)service.latencyUs[i]);
+  length += snprintf(&text[length], size - length,
+                     "], \"cross_cell_puzzles\": %llu, \"rejected_lanes\": %llu, \"invalid_lanes\": %llu}\n",
+                     (unsigned long long)service.stats.crossCellPuzzles,
+                     (unsigned long long)service.stats.rejectedLanes, (unsigned long long)service.stats.invalidLanes);
+  pthread_mutex_unlock(&service.lock);
+
+  return length;
+}
+
+static int write_all(int fd, const void *bytes, size_t length) {
+  const uint8_t *p = (const uint8_t *)bytes;
+  while (length) {
+    ssize_t written = write(fd, p, length);
+    if (written <= 0)
+      return -1;
+    p += written;
+    length -= (size_t)written;
+  }
+  return 0;
+}
+#else
+static int run_service(const char *address, int threadCount, double maxWaitMs) {
+  (void)threadCount, (void)maxWaitMs;
+  printf("Could not listen on %s, the service needs unix sockets\n", address);
+  return 1;
+}
+#endif
+#pragma endregion
+
+#pragma region tuning
+// counts a queue run against the window, and once the window is full moves the sweeps and the queue length a step
+static void tune_queue_run(int qIdx, int lastProgress, int overflowed, solver_stats_t *stats) {
+  ++stats->tunedBlocks;
+  stats->tunedSweeps += tuner.sweeps;
+  stats->tunedQueueLength += tuner.queueLength;
+#ifdef AUTO_TUNE
+  if (overflowed) {
+    ++tuner.overflows;
+    tuner.cutShort += lastProgress >= qIdx - (qIdx >> 2);
+    tuner.spinning += lastProgress < qIdx >> 1;
+  } else {
+    ++tuner.finished;
+    tuner.finishedIterations += qIdx;
+  }
+  if (++tuner.blocks < TUNE_WINDOW_BLOCKS)
+    return;
+
+  int sweeps = tuner.sweeps, queueLength = tuner.queueLength;
+  if (tuner.cutShort << 1 > tuner.overflows && queueLength < TUNE_MAX_QUEUE_LENGTH)
+    queueLength <<= 1;
+  else if (tuner.spinning << 1 > tuner.overflows && queueLength > TUNE_MIN_QUEUE_LENGTH)
+    queueLength >>= 1;
+  if (tuner.finishedIterations > (uint64_t)tuner.finished * (SUDOKU_CELL_COUNT << 1) && sweeps < TUNE_MAX_SWEEPS)
+    ++sweeps;
+  else if (tuner.finishedIterations < (uint64_t)tuner.finished * (SUDOKU_CELL_COUNT >> 1) && sweeps > TUNE_MIN_SWEEPS)
+    --sweeps;
+  stats->tuneSteps += sweeps != tuner.sweeps || queueLength != tuner.queueLength;
+
+  tuner.sweeps = sweeps;
+  tuner.queueLength = queueLength;
+  tuner.blocks >>= 1, tuner.overflows >>= 1, tuner.cutShort >>= 1, tuner.spinning >>= 1;
+  tuner.finished >>= 1, tuner.finishedIterations >>= 1;
+#else
+  (void)qIdx, (void)lastProgress, (void)overflowed;
+#endif
+}
+#pragma endregion
+
+#pragma region budget
+typedef struct {
+  const uint8_t *sudoku, *solution;
+  uint8_t *output;
+} deferred_lane_t;
+
+// the limits of the running batch, what the lane in the fallbacks has left of them, and the deferred lanes
+typedef struct {
+  budget_t budget;
+  uint64_t nodesLeft;
+  double deadlineMs;
+  int exhausted;
+  deferred_lane_t *lanes;
+  int count, capacity;
+} lane_budget_t;
+
+static __thread lane_budget_t laneBudget;
+
+// the slow pass solves with the cross cell engine, which only knows the 27 units, so variants are never deferred
+static void set_lane_budget(const budget_t *budget) {
+  laneBudget.budget = variant.unitCount ? (budget_t){0, 0} : *budget;
+}
+
+static void start_lane_budget() {
+  laneBudget.nodesLeft = laneBudget.budget.nodes;
+  laneBudget.deadlineMs = laneBudget.budget.deadlineMs > 0 ? wall_ms() + laneBudget.budget.deadlineMs : 0;
+  laneBudget.exhausted = 0;
+}
+
+// counts a guess or a dlx choice against the lane, returns 0 once the lane is out of nodes or past its deadline
+static inline int spend_budget_node() {
+  if (laneBudget.exhausted)
+    return 0;
+  if ((laneBudget.budget.nodes && !laneBudget.nodesLeft--) || (laneBudget.deadlineMs && wall_ms() > laneBudget.deadlineMs)) {
+    laneBudget.exhausted = 1;
+    return 0;
+  }
+  return 1;
+}
+
+// returns the lanes that could not be deferred
+static uint16_t defer_lanes(const uint8_t *sudokus, const uint8_t *solutions, int stride, uint8_t *output,
+                            int outputStride, uint16_t deferred) {
+  for (; deferred; deferred = (uint16_t)_blsr_u32(deferred)) {
+    int i = (int)_tzcnt_u32(deferred);
+    if (laneBudget.count == laneBudget.capacity) {
+      int capacity = laneBudget.capacity ? laneBudget.capacity << 1 : 64;
+      deferred_lane_t *lanes = (deferred_lane_t *)realloc(laneBudget.lanes, capacity * sizeof(deferred_lane_t));
+      if (!lanes)
+        return deferred;
+      laneBudget.lanes = lanes;
+      laneBudget.capacity = capacity;
+    }
+
+    deferred_lane_t *lane = &laneBudget.lanes[laneBudget.count++];
+    lane->sudoku = &sudokus[i * stride];
+    lane->solution = solutions ? &solutions[i * stride] : NULL;
+    // the solution of a kaggle layout record follows the puzzle and the comma
+    lane->output = output ? &output[i * outputStride + (outputStride == BYTES_FOR_1_SUDOKUS ? SUDOKU_CELL_COUNT + 1 : 0)]
+                          : NULL;
+  }
+  return 0;
+}
+
+// the slow pass: once its batch is done, a thread solves its deferred lanes one at a time without limits
+static void solve_deferred_lanes(solver_stats_t *stats) {
+  uint8_t solution[SUDOKU_CELL_COUNT];
+  uint64_t start = __rdtsc();
+  if (!laneBudget.count)
+    return;
+
+  for (int i = 0; i < laneBudget.count; i++) {
+    deferred_lane_t *lane = &laneBudget.lanes[i];
+    if (!solve_cross_cells(lane->sudoku, solution)) {
+      ++stats->invalidLanes;
+      continue;
+    }
+#ifdef CHECK_SOLUTIONS
+    if (lane->solution && memcmp(solution, lane->solution, SUDOKU_CELL_COUNT))
+      ++stats->failedDeferredLanes;
+#endif
+    if (lane->output)
+      memcpy(lane->output, solution, SUDOKU_CELL_COUNT);
+  }
+
+  uint64_t end = __rdtsc();
+  stats->deferredLanes += laneBudget.count;
+  stats->deferredCycles += end - start;
+  trace_span(TRACE_DEFERRED, start, end);
+  free(laneBudget.lanes);
+  laneBudget = (lane_budget_t){0};
+}
+#pragma endregion
+
+#pragma region exact cover
+// Lanes the queue phase could not finish are solved with dancing links. The matrix only holds the candidates that are
+// still open in the lane, and is rebuilt in a fixed arena for every puzzle, so a search never allocates.
+typedef struct {
+  uint16_t l[DLX_NODE_COUNT], r[DLX_NODE_COUNT], u[DLX_NODE_COUNT], d[DLX_NODE_COUNT], c[DLX_NODE_COUNT];
+  uint16_t s[DLX_NODE_COUNT], row[DLX_NODE_COUNT];
+  uint16_t header[DLX_COLUMN_COUNT];
+  uint16_t chosen[SUDOKU_CELL_COUNT];
+} dlx_t;
+
+static __thread dlx_t dlx;
+
+// returns a bit per lane that ran out of budget, those lanes are left as the queue phase left them
+static uint16_t route_unsolved_lanes(uint16_t *data, int *r2b, solver_stats_t *stats) {
+  int i, j, maxI = SUDOKU_CELL_COUNT << 4;
+  uint16_t deferred = 0;
+  __m256i_u zeroVec = _mm256_setzero_si256();
+  __m256i_u emptyCountVec = zeroVec;
+
+  for (i = 0; i < maxI; i += 16) {
+    __m256i_u pVec = load_cells(&data[i]);
+    emptyCountVec = _mm256_sub_epi16(emptyCountVec, _mm256_cmpeq_epi16(pVec, zeroVec));
+  }
+
+  uint16_t emptyCounts[16];
+  _mm256_storeu_si256((__m256i_u *)emptyCounts, emptyCountVec);
+
+  for (i = 0; i != 16; ++i) {
+    if (!emptyCounts[i])
+      continue;
+
+    start_lane_budget();
+    uint64_t traceStart = trace_begin();
+    // solve_single_puzzle walks the 27 units only, so variant lanes always go to dlx
+    if (emptyCounts[i] >= DLX_MIN_EMPTY_CELLS || variant.unitCount) {
+      ++stats->dlxLanes;
+      if (!dlx_solve_puzzle(data, i) && laneBudget.exhausted)
+        deferred |= (uint16_t)(1 << i);
+      trace_end(TRACE_DLX, traceStart);
+      continue;
+    }
+
+    // the bivalue search is cheaper for nearly solved lanes, but can stall or fail, so keep the block to retry with dlx
+    uint16_t dataCopy[DATA_LENGTH];
+    memcpy(dataCopy, data, DATA_LENGTH * sizeof(uint16_t));
+    stats->backtrackBytes += DATA_LENGTH * sizeof(uint16_t);
+    ++stats->singlePuzzleLanes;
+
+    char solved = solve_single_puzzle(data, r2b, i, stats, 0);
+    for (j = 0; solved && j < SUDOKU_CELL_COUNT; j++)
+      solved = data[(j << 4) + i] != 0;
+    trace_end(TRACE_SINGLE_PUZZLE, traceStart);
+
+    if (!solved) {
+      memcpy(data, dataCopy, DATA_LENGTH * sizeof(uint16_t));
+      stats->backtrackBytes += DATA_LENGTH * sizeof(uint16_t);
+      if (!laneBudget.exhausted) {
+        ++stats->dlxLanes;
+        traceStart = trace_begin();
+        dlx_solve_puzzle(data, i);
+        trace_end(TRACE_DLX, traceStart);
+      }
+      if (laneBudget.exhausted)
+        deferred |= (uint16_t)(1 << i);
+    }
+  }
+
+  return deferred;
+}
+
+static inline int dlx_add_header(int *nodeCount, int col) {
+  int h = (*nodeCount)++;
+
+  dlx.l[h] = dlx.l[0];
+  dlx.r[h] = 0;
+  dlx.r[dlx.l[0]] = (uint16_t)h;
+  dlx.l[0] = (uint16_t)h;
+  dlx.u[h] = dlx.d[h] = dlx.c[h] = (uint16_t)h;
+  dlx.s[h] = 0;
+  dlx.header[col] = (uint16_t)h;
+  return h;
+}
+
+static inline void dlx_cover(int col) {
+  dlx.r[dlx.l[col]] = dlx.r[col];
+  dlx.l[dlx.r[col]] = dlx.l[col];
+
+  for (int i = dlx.d[col]; i != col; i = dlx.d[i]) {
+    for (int j = dlx.r[i]; j != i; j = dlx.r[j]) {
+      dlx.d[dlx.u[j]] = dlx.d[j];
+      dlx.u[dlx.d[j]] = dlx.u[j];
+      --dlx.s[dlx.c[j]];
+    }
+  }
+}
+
+static inline void dlx_uncover(int col) {
+  for (int i = dlx.u[col]; i != col; i = dlx.u[i]) {
+    for (int j = dlx.l[i]; j != i; j = dlx.l[j]) {
+      ++dlx.s[dlx.c[j]];
+      dlx.d[dlx.u[j]] = (uint16_t)j;
+      dlx.u[dlx.d[j]] = (uint16_t)j;
+    }
+  }
+
+  dlx.r[dlx.l[col]] = (uint16_t)col;
+  dlx.l[dlx.r[col]] = (uint16_t)col;
+}
+
+// solves one lane of the block in place, returns 0 if the lane has no solution
+static char dlx_solve_puzzle(uint16_t *data, int puzzleOffset) {
+  uint16_t *p_puzzles = &data[puzzleOffset], *p_rows = &data[ROW_OFFSET + puzzleOffset],
+           *p_boxs = &data[BOX_OFFSET + puzzleOffset], *p_cols = &data[COL_OFFSET + puzzleOffset],
+           *p_extras = &data[EXTRA_OFFSET + puzzleOffset];
+  int i, j, p, r, c, b, n, col, node, k = 0, nodeCount = 1;
+
+  memset(dlx.header, 0, sizeof(dlx.header));
+  dlx.l[0] = dlx.r[0] = 0;
+
+  // every open cell needs a header up front, so a cell without candidates shows up as an empty column
+  for (p = 0; p < SUDOKU_CELL_COUNT; p++) {
+    if (!p_puzzles[p << 4])
+      dlx_add_header(&nodeCount, p);
+  }
+
+  for (p = 0; p < SUDOKU_CELL_COUNT; p++) {
+    if (p_puzzles[p << 4])
+      continue;
+
+    r = p / 9;
+    c = p % 9;
+    b = r / 3 * 3 + c / 3;
+    uint32_t bits = (uint32_t)(p_rows[r << 4] & p_boxs[b << 4] & p_cols[c << 4] & extra_candidates(p_extras, p));
+    int colCount = 4 + variant.cellUnitCount[p];
+
+    for (; bits; bits = _blsr_u32(bits)) {
+      n = (int)_tzcnt_u32(bits);
+      int cols[4 + MAX_CELL_EXTRA_UNITS] = {p, 81 + r * 9 + n, 162 + c * 9 + n, 243 + b * 9 + n};
+      for (i = 4; i < colCount; i++)
+        cols[i] = 324 + variant.cellUnits[p][i - 4] * 9 + n;
+      node = nodeCount;
+      nodeCount += colCount;
+
+      for (i = 0; i < colCount; i++) {
+        col = dlx.header[cols[i]];
+        if (!col)
+          col = dlx_add_header(&nodeCount, cols[i]);
+
+        j = node + i;
+        dlx.c[j] = (uint16_t)col;
+        dlx.row[j] = (uint16_t)(p * 9 + n);
+        dlx.l[j] = (uint16_t)(node + (i ? i - 1 : colCount - 1));
+        dlx.r[j] = (uint16_t)(node + (i + 1 < colCount ? i + 1 : 0));
+        dlx.u[j] = dlx.u[col];
+        dlx.d[j] = (uint16_t)col;
+        dlx.d[dlx.u[col]] = (uint16_t)j;
+        dlx.u[col] = (uint16_t)j;
+        ++dlx.s[col];
+      }
+    }
+  }
+
+  // algorithm X, smallest column first, iterative so the call stack stays flat
+  while (dlx.r[0] != 0) {
+    col = dlx.r[0];
+    for (j = dlx.r[col]; j != 0; j = dlx.r[j]) {
+      if (dlx.s[j] < dlx.s[col])
+        col = j;
+    }
+
+    // the matrix is rebuilt for every puzzle, so a search that runs out of budget can simply stop
+    if (!spend_budget_node())
+      return 0;
+
+    dlx_cover(col);
+    dlx.chosen[k] = dlx.d[col];
+
+    while (dlx.chosen[k] == dlx.c[dlx.chosen[k]]) {
+      // every row of this column failed, step back to the previous choice
+      dlx_uncover(dlx.chosen[k]);
+      if (k == 0)
+        return 0;
+
+      node = dlx.chosen[--k];
+      for (j = dlx.l[node]; j != node; j = dlx.l[j])
+        dlx_uncover(dlx.c[j]);
+      dlx.chosen[k] = dlx.d[node];
+    }
+
+    node = dlx.chosen[k++];
+    for (j = dlx.r[node]; j != node; j = dlx.r[j])
+      dlx_cover(dlx.c[j]);
+  }
+
+  while (k-- > 0) {
+    j = dlx.row[dlx.chosen[k]];
+    p_puzzles[(j / 9) << 4] = (uint16_t)(1 << (j % 9));
+  }
+  for (i = 0; i < 27 + variant.unitCount; i++)
+    p_rows[i << 4] = 0;
+
+  return 1;
+}
+#pragma endregion
+
+static inline void check_solutions(uint16_t *data, uint16_t *solutions, uint16_t skipped, solver_stats_t *stats) {
+  __m256i_u skippedVec = lane_vec(skipped);
+  int maxI = SUDOKU_CELL_COUNT << 4;
+  for (int i = 0; i < maxI; i += 16) {
+    __m256i_u pVec = load_cells(&data[i]);
+    __m256i_u sVec = load_cells(&solutions[i]);
+    __m256i_u mask = _mm256_or_si256(_mm256_cmpeq_epi16(pVec, sVec), skippedVec);
+
+    if (_mm256_movemask_epi8(mask) != 0xFFFFFFFF) {
+      ++stats->failedBlocks;
+      break;
+    }
+  }
+}
+
+// checks the solved block against the sudoku rules alone, returns a bit per lane that is not a valid solution of its
+// givens: a unit that does not OR to all nine digits, two cells of a unit sharing a digit, or a given that was changed
+static inline uint16_t validate_solutions(const uint16_t *data, const uint16_t *givens, int *r2b) {
+  __m256i_u rows[9], boxs[9], cols[9];
+  __m256i_u zeroVec = _mm256_setzero_si256();
+  __m256i_u maskVec = _mm256_set1_epi16((short)0b111111111);
+  __m256i_u overlapVec = zeroVec, lostVec = zeroVec, badVec = zeroVec;
+  int i, p, r, b, c, maxB, maxC;
+
+  for (i = 0; i < 9; i++)
+    rows[i] = boxs[i] = cols[i] = zeroVec;
+
+  for (p = 0, r = 0; r < 9; r++) {
+    for (b = r2b[r], maxB = b + 3, c = 0; b < maxB; b++) {
+      for (maxC = c + 3; c < maxC; c++, p++) {
+        __m256i_u pVec = load_cells(&data[p << 4]);
+        __m256i_u gVec = load_cells(&givens[p << 4]);
+
+        overlapVec = _mm256_or_si256(overlapVec, _mm256_and_si256(pVec, rows[r]));
+        overlapVec = _mm256_or_si256(overlapVec, _mm256_and_si256(pVec, boxs[b]));
+        overlapVec = _mm256_or_si256(overlapVec, _mm256_and_si256(pVec, cols[c]));
+        lostVec = _mm256_or_si256(lostVec, _mm256_andnot_si256(pVec, gVec));
+        badVec = _mm256_or_si256(badVec, _mm256_cmpeq_epi16(pVec, zeroVec));
+
+        rows[r] = _mm256_or_si256(rows[r], pVec);
+        boxs[b] = _mm256_or_si256(boxs[b], pVec);
+        cols[c] = _mm256_or_si256(cols[c], pVec);
+      }
+    }
+  }
+
+  __m256i_u fullVec = _mm256_cmpeq_epi16(zeroVec, zeroVec);
+  for (i = 0; i < 9; i++) {
+    fullVec = _mm256_and_si256(fullVec, _mm256_cmpeq_epi16(rows[i], maskVec));
+    fullVec = _mm256_and_si256(fullVec, _mm256_cmpeq_epi16(boxs[i], maskVec));
+    fullVec = _mm256_and_si256(fullVec, _mm256_cmpeq_epi16(cols[i], maskVec));
+  }
+
+  __m256i_u validVec = _mm256_and_si256(fullVec, _mm256_cmpeq_epi16(_mm256_or_si256(overlapVec, lostVec), zeroVec));
+  return (uint16_t)~lane_mask(_mm256_andnot_si256(badVec, validVec));
+}
+
+#pragma region arena
+// Scratch areas of BLOCK_SCRATCH_LENGTH, 64 byte aligned and a whole number of cache lines each, so every vector of a
+// block is an aligned load or store and never splits a line.
+static uint16_t *alloc_block_arena(int areaCount, int node) {
+  return (uint16_t *)alloc_on_node((size_t)areaCount * BLOCK_SCRATCH_LENGTH * sizeof(uint16_t), node);
+}
+
+static void free_block_arena(uint16_t *arena, int areaCount, int node) {
+  free_on_node(arena, (size_t)areaCount * BLOCK_SCRATCH_LENGTH * sizeof(uint16_t), node);
+}
+
+static inline __m256i load_cells(const void *p) { return _mm256_load_si256((const __m256i *)p); }
+static inline void store_cells(void *p, __m256i vec) { _mm256_store_si256((__m256i *)p, vec); }
+
+// Touches every cache line of a block's 16 records, and of its solutions when they live in their own buffer. The
+// 164 byte kaggle stride puts records across lines irregularly, which the hardware prefetcher follows late.
+static inline void prefetch_block(const uint8_t *sudokus, const uint8_t *solutions, int stride) {
+  const uint8_t *end = sudokus + 16 * stride;
+  for (const uint8_t *p = (const uint8_t *)((uintptr_t)sudokus & ~(uintptr_t)63); p < end; p += 64)
+    _mm_prefetch((const char *)p, _MM_HINT_T0);
+
+  if (solutions && (solutions < sudokus || solutions >= end)) {
+    end = solutions + 16 * stride;
+    for (const uint8_t *p = (const uint8_t *)((uintptr_t)solutions & ~(uintptr_t)63); p < end; p += 64)
+      _mm_prefetch((const char *)p, _MM_HINT_T0);
+  }
+}
+#pragma endregion
+
+// compresses a vector of 16 bit lanes that are all ones or all zeros into one bit per lane
+static inline uint16_t lane_mask(__m256i_u vec) {
+  __m256i_u packed = _mm256_permute4x64_epi64(_mm256_packs_epi16(vec, vec), 0b1000);
+  return (uint16_t)_mm256_movemask_epi8(packed);
+}
+
+// expands a bit per lane into a vector of 16 bit lanes that are all ones or all zeros
+static inline __m256i_u lane_vec(uint16_t mask) {
+  __m256i_u laneBitsVec = _mm256_setr_epi16(1 << 0, 1 << 1, 1 << 2, 1 << 3, 1 << 4, 1 << 5, 1 << 6, 1 << 7, 1 << 8,
+                                            1 << 9, 1 << 10, 1 << 11, 1 << 12, 1 << 13, 1 << 14, (short)(1 << 15));
+  return _mm256_cmpeq_epi16(_mm256_and_si256(_mm256_set1_epi16((short)mask), laneBitsVec), laneBitsVec);
+}
+
+#pragma region trace
+// A span is 16 bytes: its start in cycles, its length and the phase. Every thread appends to its own ring without
+// locks, the rings are only registered, and read once the threads are done.
+typedef struct {
+  uint64_t start;
+  uint32_t cycles;
+  uint32_t phase;
+} trace_span_t;
+
+typedef struct {
+  trace_span_t *spans;
+  uint64_t count;
+} trace_ring_t;
+
+static const char *tracePhaseNames[TRACE_PHASE_COUNT] = {
+    "read", "parse", "transform", "setup", "sweeps", "queue", "single puzzle", "dlx", "verify", "write", "deferred",
+    "bit sliced"};
+
+static struct {
+  int enabled, ringCount;
+  uint64_t startCycles;
+  double startMs;
+  trace_ring_t *rings[MAX_THREAD_COUNT + 1];
+  pthread_mutex_t lock;
+} trace = {0, 0, 0, 0, {0}, PTHREAD_MUTEX_INITIALIZER};
+
+static __thread trace_ring_t *traceRing;
+
+static void enable_trace() {
+  trace.startMs = wall_ms();
+  trace.startCycles = __rdtsc();
+  trace.enabled = 1;
+}
+
+// returns 0 when tracing is off, which trace_end takes as nothing to record
+static inline uint64_t trace_begin() {
+#ifdef TRACE
+  if (trace.enabled)
+    return __rdtsc();
+#endif
+  return 0;
+}
+
+static inline void trace_end(int phase, uint64_t start) {
+  if (start)
+    trace_span(phase, start, __rdtsc());
+}
+
+static void trace_span(int phase, uint64_t start, uint64_t end) {
+#ifdef TRACE
+  if (!trace.enabled)
+    return;
+
+  if (!traceRing) {
+    pthread_mutex_lock(&trace.lock);
+    if (trace.ringCount <= MAX_THREAD_COUNT) {
+      traceRing = (trace_ring_t *)calloc(1, sizeof(trace_ring_t));
+      if (traceRing)
+        traceRing->spans = (trace_span_t *)malloc(TRACE_RING_LENGTH * sizeof(trace_span_t));
+      // a thread without a ring records nothing
+      if (traceRing && traceRing->spans) {
+        trace.rings[trace.ringCount++] = traceRing;
+      } else {
+        free(traceRing);
+        traceRing = NULL;
+      }
+    }
+    pthread_mutex_unlock(&trace.lock);
+    if (!traceRing)
+      return;
+  }
+
+  trace_span_t *span = &traceRing->spans[traceRing->count++ & (TRACE_RING_LENGTH - 1)];
+  span->start = start;
+  span->cycles = (uint32_t)(end - start > UINT32_MAX ? UINT32_MAX : end - start);
+  span->phase = (uint32_t)phase;
+#else
+  (void)phase;
+  (void)start;
+  (void)end;
+#endif
+}
+
+// Writes the spans of all rings as complete events of the chrome trace format, a tid per ring. Cycles are converted
+// with the rate measured between enable_trace and now. Returns 0 on success.
+static int write_trace_json(const char *path) {
+  FILE *fp = fopen(path, "w");
+  if (!fp)
+    return 1;
+
+  double cyclesPerUs = (double)(__rdtsc() - trace.startCycles) / ((wall_ms() - trace.startMs) * 1000);
+  int first = 1;
+
+  fprintf(fp, "{\"traceEvents\": [\n");
+  for (int i = 0; i < trace.ringCount; i++) {
+    trace_ring_t *ring = trace.rings[i];
+    uint64_t j = ring->count > TRACE_RING_LENGTH ? ring->count - TRACE_RING_LENGTH : 0;
+
+    for (; j < ring->count; j++) {
+      trace_span_t *span = &ring->spans[j & (TRACE_RING_LENGTH - 1)];
+      fprintf(fp, "%s{\"name\": \"%s\", \"ph\": \"X\", \"pid\": 1, \"tid\": %d, \"ts\": %.3f, \"dur\": %.3f}",
+              first ? "" : ",\n", tracePhaseNames[span->phase], i,
+              (double)(int64_t)(span->start - trace.startCycles) / cyclesPerUs, span->cycles / cyclesPerUs);
+      first = 0;
+    }
+  }
+  fprintf(fp, "\n], \"displayTimeUnit\": \"ns\"}\n");
+
+  return fclose(fp) != 0;
+}
+#pragma endregion
+
+#pragma region stats
+// counters are plain per-thread increments, merge_stats folds them together once the threads are done
+static void merge_stats(solver_stats_t *dest, const solver_stats_t *src) {
+  dest->blocks += src->blocks;
+  dest->failedBlocks += src->failedBlocks;
+  dest->rejectedLanes += src->rejectedLanes;
+  dest->invalidLanes += src->invalidLanes;
+  dest->overflowBlocks += src->overflowBlocks;
+  dest->fullSweeps += src->fullSweeps;
+  dest->queueIterations += src->queueIterations;
+  dest->singlePuzzleLanes += src->singlePuzzleLanes;
+  dest->dlxLanes += src->dlxLanes;
+  dest->crossCellPuzzles += src->crossCellPuzzles;
+  dest->deferredLanes += src->deferredLanes;
+  dest->failedDeferredLanes += src->failedDeferredLanes;
+  dest->bitslicedBlocks += src->bitslicedBlocks;
+  dest->backtrackBytes += src->backtrackBytes;
+  dest->transformCycles += src->transformCycles;
+  dest->deferredCycles += src->deferredCycles;
+  dest->tunedBlocks += src->tunedBlocks;
+  dest->tunedSweeps += src->tunedSweeps;
+  dest->tunedQueueLength += src->tunedQueueLength;
+  dest->tuneSteps += src->tuneSteps;
+  for (int i = 0; i < STATS_GUESS_DEPTH_COUNT; i++)
+    dest->guessDepth[i] += src->guessDepth[i];
+}
+
+static void print_stats(const solver_stats_t *stats) {
+  printf("Failed: %llu\n", (unsigned long long)stats->failedBlocks);
+  printf("Rejected: %llu\n", (unsigned long long)stats->rejectedLanes);
+  printf("Invalid: %llu\n", (unsigned long long)stats->invalidLanes);
+  printf("Full iterations: %llu\n", (unsigned long long)(stats->fullSweeps * SUDOKU_CELL_COUNT));
+  printf("Queue iterations: %llu\n", (unsigned long long)stats->queueIterations);
+  printf("Overflowed blocks: %llu\n", (unsigned long long)stats->overflowBlocks);
+  printf("Transform cycles per block: %.0f\n", stats->blocks ? (double)stats->transformCycles / stats->blocks : 0.0);
+  if (stats->tunedBlocks)
+    printf("Sweeps: %.2f, queue length: %.0f, tuner steps: %llu\n", (double)stats->tunedSweeps / stats->tunedBlocks,
+           (double)stats->tunedQueueLength / stats->tunedBlocks, (unsigned long long)stats->tuneSteps);
+  printf("Single puzzle lanes: %llu, dlx lanes: %llu\n", (unsigned long long)stats->singlePuzzleLanes,
+         (unsigned long long)stats->dlxLanes);
+  if (stats->bitslicedBlocks)
+    printf("Bit sliced blocks: %llu\n", (unsigned long long)stats->bitslicedBlocks);
+  if (stats->crossCellPuzzles)
+    printf("Cross cell puzzles: %llu\n", (unsigned long long)stats->crossCellPuzzles);
+  if (stats->deferredLanes)
+    printf("Deferred lanes: %llu, cycles each: %.0f\n", (unsigned long long)stats->deferredLanes,
+           (double)stats->deferredCycles / stats->deferredLanes);
+  if (stats->failedDeferredLanes)
+    printf("Failed deferred lanes: %llu\n", (unsigned long long)stats->failedDeferredLanes);
+}
+
+static void write_stats_json(FILE *fp, const solver_stats_t *stats) {
+  double blocks = stats->blocks ? (double)stats->blocks : 1;
+
+  fprintf(fp, "{\n");
+  fprintf(fp, "  \"blocks\": %llu,\n", (unsigned long long)stats->blocks);
+  fprintf(fp, "  \"failed_blocks\": %llu,\n", (unsigned long long)stats->failedBlocks);
+  fprintf(fp, "  \"rejected_lanes\": %llu,\n", (unsigned long long)stats->rejectedLanes);
+  fprintf(fp, "  \"invalid_lanes\": %llu,\n", (unsigned long long)stats->invalidLanes);
+  fprintf(fp, "  \"overflow_blocks\": %llu,\n", (unsigned long long)stats->overflowBlocks);
+  fprintf(fp, "  \"full_sweeps\": %llu,\n", (unsigned long long)stats->fullSweeps);
+  fprintf(fp, "  \"queue_iterations\": %llu,\n", (unsigned long long)stats->queueIterations);
+  fprintf(fp, "  \"full_sweeps_per_block\": %.3f,\n", stats->fullSweeps / blocks);
+  fprintf(fp, "  \"queue_iterations_per_block\": %.3f,\n", stats->queueIterations / blocks);
+  double tunedBlocks = stats->tunedBlocks ? (double)stats->tunedBlocks : 1;
+  fprintf(fp, "  \"tuned_sweeps\": %.3f,\n", stats->tunedSweeps / tunedBlocks);
+  fprintf(fp, "  \"tuned_queue_length\": %.1f,\n", stats->tunedQueueLength / tunedBlocks);
+  fprintf(fp, "  \"tuner_steps\": %llu,\n", (unsigned long long)stats->tuneSteps);
+  fprintf(fp, "  \"single_puzzle_lanes\": %llu,\n", (unsigned long long)stats->singlePuzzleLanes);
+  fprintf(fp, "  \"dlx_lanes\": %llu,\n", (unsigned long long)stats->dlxLanes);
+  fprintf(fp, "  \"cross_cell_puzzles\": %llu,\n", (unsigned long long)stats->crossCellPuzzles);
+  fprintf(fp, "  \"bitsliced_blocks\": %llu,\n", (unsigned long long)stats->bitslicedBlocks);
+  fprintf(fp, "  \"deferred_lanes\": %llu,\n", (unsigned long long)stats->deferredLanes);
+  fprintf(fp, "  \"failed_deferred_lanes\": %llu,\n", (unsigned long long)stats->failedDeferredLanes);
+  fprintf(fp, "  \"deferred_cycles\": %llu,\n", (unsigned long long)stats->deferredCycles);
+  fprintf(fp, "  \"backtrack_bytes\": %llu,\n", (unsigned long long)stats->backtrackBytes);
+  fprintf(fp, "  \"transform_cycles_per_block\": %.1f,\n", stats->transformCycles / blocks);
+  fprintf(fp, "  \"guess_depth\": [");
+  for (int i = 0; i < STATS_GUESS_DEPTH_COUNT; i++)
+    fprintf(fp, i ? ", %llu" : "%llu", (unsigned long long)stats->guessDepth[i]);
+  fprintf(fp, "]\n}\n");
+}
+#pragma endregion
+
+#pragma region tests
+static inline void test_transform_sudokus(const uint8_t *sudokus, int stride, uint16_t *data) {
+  int i, j, sOffset;
+  int testData[SUDOKU_CELL_COUNT << 4];
+
+  for (i = 0; i < 16; i++) {
+    sOffset = i * stride;
+    for (j = 0; j < SUDOKU_CELL_COUNT; j++) {
+      uint8_t ch = sudokus[sOffset + j];
+      testData[(j << 4) + i] = ch < '0' || ch > '9' ? 0 : (uint16_t)(0b100000000 >> ('9' - ch));
+    }
+  }
+
+  for (i = 0; i < SUDOKU_CELL_COUNT << 4; i++) {
+    if (data[i] != testData[i]) {
+      printf("transform fail: %d <> %d (i=%d)", data[i], testData[i], i);
+      exit(1);
+    }
+  }
+}
+static void test_setup_step(uint16_t *data) {
+  int len = EXTRA_OFFSET - ROW_OFFSET;
+  uint16_t dataArr[len];
+  for (int i = 0; i < len; i++) {
+    dataArr[i] = data[i + ROW_OFFSET];
+  }
+
+  uint16_t testData[len];
+  for (int i = 0; i < len; i++) {
+    testData[i] = 0b111111111;
+  }
+
+  uint16_t *p_rows = &testData[0], *p_boxs = &testData[9 << 4], *p_cols = &testData[(9 << 4) * 2];
+  for (int i = 0; i < 16; i++) {
+    for (int p = 0; p < 81; p++) {
+      int r = p / 9;
+      int c = p % 9;
+      int b = r / 3 * 3 + c / 3;
+
+      uint16_t mask = ~data[(p << 4) + i];
+      p_rows[(r << 4) + i] &= mask;
+      p_boxs[(b << 4) + i] &= mask;
+      p_cols[(c << 4) + i] &= mask;
+    }
+  }
+
+  for (int i = 0; i < len; i++) {
+    if (dataArr[i] != testData[i]) {
+      printf("SetupStep fail: %d <> %d", dataArr[i], testData[i]);
+      exit(1);
+    }
+  }
+}
+
+#pragma endregion
+
+#pragma region debug
+
+static void print_sudoku(uint16_t *data, int puzzleOffset) {
+  int bit2num[1 << 9];
+  bit2num[0] = 0;
+  int num = 1, bit = 1;
+
+  while (num <= 9) {
+    bit2num[bit] = num;
+    bit <<= 1;
+    ++num;
+  }
+
+  for (int i = 0; i < SUDOKU_CELL_COUNT; i++) {
+    if (i > 0) {
       if (i % 3 == 0)
         printf(" ");
       if (i % 9 == 0)
@@ -565,4 +4457,9 @@ static void print_sudoku(uint16_t *data, int puzzleOffset) {
   printf("\n\n\n");
 }
 
-static double time_ms(const clock_t start, const clock_t end) { return ((double)(end - start) * 1000 / CLOCKS_PER_SEC); }
+// clock() adds up cpu time of all threads on linux, so the timings use wall time
+static double wall_ms() {
+  struct timespec ts;
+  timespec_get(&ts, TIME_UTC);
+  return (double)ts.tv_sec * 1000 + (double)ts.tv_nsec / 1000000;
+}
@@ -0,0 +1,40 @@
+// C ABI of solverAvx2.c, built as a library with SOLVER_LIBRARY defined, which leaves out main:
+//   g++ -O3 -march=native -shared -fPIC -pthread -DSOLVER_LIBRARY solverAvx2.c -o libsudoku.so
+#pragma once
+
+#include "stddef.h"
+#include "stdint.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// the low 8 bits of flags are the number of solver threads, 0 for one per online cpu
+#define SOLVE_BATCH_THREADS(n) ((uint32_t)(n) & 0xFF)
+
+// Solves n puzzles of 81 cells ('1'..'9', '0' for blanks) laid out back to back in `in`, and writes the 81 digits of
+// each solution to `out`, which must not overlap `in`. A puzzle that is malformed or has no solution gets 81 '0's.
+// Returns the number of those puzzles, or -1 if in or out is missing.
+int64_t solve_batch(const uint8_t *in, uint8_t *out, size_t n, uint32_t flags);
+
+#define SUDOKU_HINT_NONE 0
+#define SUDOKU_HINT_NAKED_SINGLE 1
+#define SUDOKU_HINT_HIDDEN_SINGLE 2
+// a malformed board, two equal digits in a unit, or a cell or unit left without a place for a digit
+#define SUDOKU_HINT_INVALID 3
+
+// The next forced move of a board: the first cell with a single candidate, or else the first row (unit 0..8), column
+// (9..17) or box (18..26) with a single place for a digit, lowest digit first. cell is 0..80 and digit 1..9.
+typedef struct {
+  uint8_t kind, cell, digit, unit;
+} sudoku_hint_t;
+
+// Runs only the candidate elimination of the givens on n partial boards laid out like the puzzles of solve_batch, no
+// search. candidates, when not NULL, gets 81 masks per board, bit d - 1 set while digit d fits the cell, a filled cell
+// has the bit of its digit alone. hints gets one hint per board. flags is reserved, pass 0. Returns the number of
+// invalid boards, or -1 if in or hints is missing.
+int64_t hint_batch(const uint8_t *in, uint16_t *candidates, sudoku_hint_t *hints, size_t n, uint32_t flags);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,88 @@
+#include "solverEngine.hpp"
+#include "stdio.h"
+#include "stdlib.h"
+#include "time.h"
+
+// pick the box size, the lane width and the propagation rules of the engine. 16x16 (box 4) still fits 16 bit lanes,
+// 25x25 (box 5) needs the 32 bit lanes.
+#ifndef ENGINE_BOX
+#define ENGINE_BOX 3
+#endif
+#ifndef ENGINE_LANES
+#define ENGINE_LANES std::conditional<(ENGINE_BOX <= 4), sudoku::Avx2Lanes, sudoku::Avx2Lanes32>::type
+#endif
+#ifndef ENGINE_RULES
+#define ENGINE_RULES sudoku::HiddenSingles
+#endif
+
+typedef sudoku::Engine<ENGINE_LANES, ENGINE_RULES, ENGINE_BOX> engine_t;
+
+// kaggle layout: the cells, a comma, the solution and a newline, 164 bytes for 9x9
+#define BYTES_FOR_1_SUDOKUS (2 * engine_t::cellCount + 2)
+
+static double wall_ms();
+
+// usage: solverEngine [input], the input in the kaggle layout with or without a header line. Grids above 9x9 use the
+// letters of sudoku::DIGIT_CHARS after '9'.
+int main(int argc, char **argv) {
+  const char *inputPath = argc > 1 ? argv[1] : "../sudoku.csv";
+  FILE *fp = fopen(inputPath, "rb");
+  if (!fp) {
+    printf("Could not read %s\n", inputPath);
+    return 1;
+  }
+
+  fseek(fp, 0, SEEK_END);
+  size_t length = (size_t)ftell(fp);
+  fseek(fp, 0, SEEK_SET);
+  uint8_t *bytes = (uint8_t *)malloc(length);
+  length = fread(bytes, 1, length, fp);
+  fclose(fp);
+
+  const uint8_t *records = bytes;
+  if (length && !memchr(sudoku::DIGIT_CHARS, bytes[0], sizeof(sudoku::DIGIT_CHARS) - 1) && bytes[0] != '0' &&
+      bytes[0] != '.') {
+    const uint8_t *newline = (const uint8_t *)memchr(bytes, '\n', length);
+    records = newline ? newline + 1 : bytes + length;
+  }
+  int count = (int)((size_t)(bytes + length - records) / BYTES_FOR_1_SUDOKUS);
+
+  constexpr int width = engine_t::width, cellCount = engine_t::cellCount;
+  static engine_t engine;
+  static uint8_t solutions[width * cellCount], tail[width * BYTES_FOR_1_SUDOKUS];
+  int failed = 0, wrong = 0;
+
+  double start = wall_ms();
+  for (int i = 0; i < count; i += width) {
+    const uint8_t *block = &records[(size_t)i * BYTES_FOR_1_SUDOKUS];
+    int blockCount = count - i < width ? count - i : width;
+
+    // the last block is padded with copies of its first puzzle
+    if (blockCount < width) {
+      for (int j = 0; j < width; j++)
+        memcpy(&tail[j * BYTES_FOR_1_SUDOKUS], &block[(j < blockCount ? j : 0) * BYTES_FOR_1_SUDOKUS],
+               BYTES_FOR_1_SUDOKUS);
+      block = tail;
+    }
+
+    uint32_t failedLanes = engine.solve(block, BYTES_FOR_1_SUDOKUS, solutions, cellCount);
+    for (int j = 0; j < blockCount; j++) {
+      failed += (int)(failedLanes >> j & 1);
+      wrong += memcmp(&solutions[j * cellCount], &block[j * BYTES_FOR_1_SUDOKUS + cellCount + 1], cellCount) != 0;
+    }
+  }
+  double end = wall_ms();
+
+  printf("Solving %d sudokus took: %.0fms\n", count, end - start);
+  printf("Failed: %d\n", failed);
+  printf("Wrong: %d\n", wrong);
+
+  free(bytes);
+  return 0;
+}
+
+static double wall_ms() {
+  struct timespec ts;
+  timespec_get(&ts, TIME_UTC);
+  return (double)ts.tv_sec * 1000 + (double)ts.tv_nsec / 1000000;
+}
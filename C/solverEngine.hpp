@@ -0,0 +1,415 @@
+// Header-only take on the solverAvx2.c block engine. The unit and peer tables are constexpr and the sweep over the
+// cells is unrolled at compile time, so the row, col and box of every cell are immediates instead of r2b lookups.
+// Lanes (how many puzzles are solved side by side, and with which instructions) and Rules (what a sweep propagates)
+// are policies picked at compile time, and so is the box size of the grid:
+//
+//   sudoku::Engine<sudoku::Avx2Lanes, sudoku::HiddenSingles> engine;
+//   uint32_t failed = engine.solve(puzzles, stride, solutions, solutionStride);
+//
+//   sudoku::Engine<sudoku::Avx2Lanes32, sudoku::HiddenSingles, 5> engine25x25;
+#pragma once
+
+#include "immintrin.h"
+#include "stdint.h"
+#include "string.h"
+#include <type_traits>
+#include <utility>
+
+namespace sudoku {
+
+// digits of the grid sizes up to 25x25, blanks are '0' or '.'
+constexpr char DIGIT_CHARS[] = "123456789ABCDEFGHIJKLMNOP";
+
+// A grid of Box x Box boxes holds Box * Box digits, up to 16 candidates fit 16 bit masks and 25 need 32 bits. Units
+// 0..size-1 are the rows, then the cols and then the boxes.
+template <int Box> struct Grid {
+  static_assert(Box >= 2 && Box <= 5, "grids from 4x4 to 25x25");
+
+  static constexpr int size = Box * Box;
+  static constexpr int cellCount = size * size;
+  static constexpr int unitCount = 3 * size;
+  static constexpr int peerCount = 2 * (size - 1) + (Box - 1) * (Box - 1);
+  typedef typename std::conditional<(size <= 16), uint16_t, uint32_t>::type mask;
+  static constexpr mask allDigits = (mask)((1ull << size) - 1);
+
+  static constexpr int row(int cell) { return cell / size; }
+  static constexpr int col(int cell) { return size + cell % size; }
+  static constexpr int box(int cell) { return 2 * size + cell / (size * Box) * Box + cell % size / Box; }
+};
+
+constexpr int CELL_COUNT = Grid<3>::cellCount;
+
+#pragma region tables
+template <int Box> struct UnitTable {
+  uint16_t cells[Grid<Box>::unitCount][Grid<Box>::size];
+};
+
+template <int Box> constexpr UnitTable<Box> make_units() {
+  typedef Grid<Box> G;
+  UnitTable<Box> table = {};
+  int counts[G::unitCount] = {};
+  for (int cell = 0; cell < G::cellCount; cell++) {
+    int units[3] = {G::row(cell), G::col(cell), G::box(cell)};
+    for (int unit : units)
+      table.cells[unit][counts[unit]++] = (uint16_t)cell;
+  }
+  return table;
+}
+
+template <int Box> struct PeerTable {
+  uint16_t cells[Grid<Box>::cellCount][Grid<Box>::peerCount];
+};
+
+template <int Box> constexpr PeerTable<Box> make_peers() {
+  typedef Grid<Box> G;
+  PeerTable<Box> table = {};
+  for (int cell = 0; cell < G::cellCount; cell++) {
+    int count = 0;
+    for (int peer = 0; peer < G::cellCount; peer++) {
+      if (peer != cell && (G::row(peer) == G::row(cell) || G::col(peer) == G::col(cell) || G::box(peer) == G::box(cell)))
+        table.cells[cell][count++] = (uint16_t)peer;
+    }
+  }
+  return table;
+}
+
+// num2bit from solver1.c for any size, a digit character to its candidate bit, 0 for anything else
+template <int Box> struct DigitTable {
+  typename Grid<Box>::mask num2bit[256];
+};
+
+template <int Box> constexpr DigitTable<Box> make_digits() {
+  DigitTable<Box> table = {};
+  for (int digit = 0; digit < Grid<Box>::size; digit++)
+    table.num2bit[(uint8_t)DIGIT_CHARS[digit]] = (typename Grid<Box>::mask)(1u << digit);
+  return table;
+}
+
+template <int Box> constexpr UnitTable<Box> UNITS = make_units<Box>();
+template <int Box> constexpr PeerTable<Box> PEERS = make_peers<Box>();
+template <int Box> constexpr DigitTable<Box> DIGITS = make_digits<Box>();
+#pragma endregion
+
+#pragma region lanes
+// a lane per puzzle, 16 bit candidate masks, comparisons give all ones or all zeros per lane
+struct Avx2Lanes {
+  static constexpr int width = 16;
+  typedef uint16_t mask;
+  typedef __m256i vec;
+
+  static vec load(const uint16_t *p) { return _mm256_load_si256((const __m256i *)p); }
+  static void store(uint16_t *p, vec v) { _mm256_store_si256((__m256i *)p, v); }
+  static vec set1(uint16_t x) { return _mm256_set1_epi16((short)x); }
+  static vec and_(vec a, vec b) { return _mm256_and_si256(a, b); }
+  static vec or_(vec a, vec b) { return _mm256_or_si256(a, b); }
+  static vec andnot(vec a, vec b) { return _mm256_andnot_si256(a, b); }
+  static vec sub(vec a, vec b) { return _mm256_sub_epi16(a, b); }
+  static vec cmpeq(vec a, vec b) { return _mm256_cmpeq_epi16(a, b); }
+  static bool any(vec v) { return !_mm256_testz_si256(v, v); }
+  // a bit per lane of a comparison result
+  static uint32_t lanes(vec v) {
+    return (uint32_t)_mm_movemask_epi8(_mm_packs_epi16(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1)));
+  }
+};
+
+// 32 bit masks for 25x25, half the lanes
+struct Avx2Lanes32 {
+  static constexpr int width = 8;
+  typedef uint32_t mask;
+  typedef __m256i vec;
+
+  static vec load(const uint32_t *p) { return _mm256_load_si256((const __m256i *)p); }
+  static void store(uint32_t *p, vec v) { _mm256_store_si256((__m256i *)p, v); }
+  static vec set1(uint32_t x) { return _mm256_set1_epi32((int)x); }
+  static vec and_(vec a, vec b) { return _mm256_and_si256(a, b); }
+  static vec or_(vec a, vec b) { return _mm256_or_si256(a, b); }
+  static vec andnot(vec a, vec b) { return _mm256_andnot_si256(a, b); }
+  static vec sub(vec a, vec b) { return _mm256_sub_epi32(a, b); }
+  static vec cmpeq(vec a, vec b) { return _mm256_cmpeq_epi32(a, b); }
+  static bool any(vec v) { return !_mm256_testz_si256(v, v); }
+  static uint32_t lanes(vec v) { return (uint32_t)_mm256_movemask_ps(_mm256_castsi256_ps(v)); }
+};
+
+struct Sse2Lanes {
+  static constexpr int width = 8;
+  typedef uint16_t mask;
+  typedef __m128i vec;
+
+  static vec load(const uint16_t *p) { return _mm_load_si128((const __m128i *)p); }
+  static void store(uint16_t *p, vec v) { _mm_store_si128((__m128i *)p, v); }
+  static vec set1(uint16_t x) { return _mm_set1_epi16((short)x); }
+  static vec and_(vec a, vec b) { return _mm_and_si128(a, b); }
+  static vec or_(vec a, vec b) { return _mm_or_si128(a, b); }
+  static vec andnot(vec a, vec b) { return _mm_andnot_si128(a, b); }
+  static vec sub(vec a, vec b) { return _mm_sub_epi16(a, b); }
+  static vec cmpeq(vec a, vec b) { return _mm_cmpeq_epi16(a, b); }
+  static bool any(vec v) { return _mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_setzero_si128())) != 0xFFFF; }
+  static uint32_t lanes(vec v) { return (uint32_t)_mm_movemask_epi8(_mm_packs_epi16(v, _mm_setzero_si128())); }
+};
+
+struct Sse2Lanes32 {
+  static constexpr int width = 4;
+  typedef uint32_t mask;
+  typedef __m128i vec;
+
+  static vec load(const uint32_t *p) { return _mm_load_si128((const __m128i *)p); }
+  static void store(uint32_t *p, vec v) { _mm_store_si128((__m128i *)p, v); }
+  static vec set1(uint32_t x) { return _mm_set1_epi32((int)x); }
+  static vec and_(vec a, vec b) { return _mm_and_si128(a, b); }
+  static vec or_(vec a, vec b) { return _mm_or_si128(a, b); }
+  static vec andnot(vec a, vec b) { return _mm_andnot_si128(a, b); }
+  static vec sub(vec a, vec b) { return _mm_sub_epi32(a, b); }
+  static vec cmpeq(vec a, vec b) { return _mm_cmpeq_epi32(a, b); }
+  static bool any(vec v) { return _mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_setzero_si128())) != 0xFFFF; }
+  static uint32_t lanes(vec v) { return (uint32_t)_mm_movemask_ps(_mm_castsi128_ps(v)); }
+};
+
+template <class Mask> struct ScalarLanesOf {
+  static constexpr int width = 1;
+  typedef Mask mask;
+  typedef Mask vec;
+
+  static vec load(const Mask *p) { return *p; }
+  static void store(Mask *p, vec v) { *p = v; }
+  static vec set1(Mask x) { return x; }
+  static vec and_(vec a, vec b) { return (vec)(a & b); }
+  static vec or_(vec a, vec b) { return (vec)(a | b); }
+  static vec andnot(vec a, vec b) { return (vec)(~a & b); }
+  static vec sub(vec a, vec b) { return (vec)(a - b); }
+  static vec cmpeq(vec a, vec b) { return a == b ? (vec)~(vec)0 : (vec)0; }
+  static bool any(vec v) { return v != 0; }
+  static uint32_t lanes(vec v) { return v != 0; }
+};
+
+typedef ScalarLanesOf<uint16_t> ScalarLanes;
+typedef ScalarLanesOf<uint32_t> ScalarLanes32;
+#pragma endregion
+
+#pragma region rules
+// naked singles only, what solve_cell in solverAvx2.c does
+struct NakedSingles {
+  static constexpr bool hiddenSingles = false;
+};
+
+// once a sweep places nothing, a digit that fits a single cell of a unit is placed there
+struct HiddenSingles {
+  static constexpr bool hiddenSingles = true;
+};
+#pragma endregion
+
+template <class Lanes, class Rules = NakedSingles, int Box = 3> class Engine {
+  typedef Grid<Box> G;
+  static_assert(sizeof(typename Lanes::mask) * 8 >= G::size, "the lanes are too narrow for the digits of the grid");
+
+public:
+  static constexpr int width = Lanes::width;
+  static constexpr int cellCount = G::cellCount;
+  typedef typename Lanes::vec vec;
+  typedef typename Lanes::mask mask;
+
+  // Solves width puzzles of cellCount cells (DIGIT_CHARS, '0' or '.' for blanks) at stride and writes their digits at
+  // solutionStride. Returns a bit per lane that was malformed or has no solution, its digits are all '0'.
+  uint32_t solve(const uint8_t *puzzles, int stride, uint8_t *solutions, int solutionStride) {
+    uint32_t allLanes = (uint32_t)((1ull << width) - 1);
+    uint32_t failed = setup(puzzles, stride);
+    failed |= allLanes & ~search(allLanes & ~failed);
+
+    for (int lane = 0; lane < width; lane++) {
+      uint8_t *solution = &solutions[lane * solutionStride];
+      for (int cell = 0; cell < G::cellCount; cell++)
+        solution[cell] = failed >> lane & 1 ? '0' : (uint8_t)DIGIT_CHARS[_tzcnt_u32(cells[cell][lane])];
+    }
+    return failed;
+  }
+
+private:
+  alignas(64) mask cells[G::cellCount][width];
+  // remaining digits of every unit, in the order of UNITS
+  alignas(64) mask units[G::unitCount][width];
+
+  // returns a bit per lane with a character that is not a digit of the grid, '0' or '.', or a digit given twice in a
+  // unit
+  uint32_t setup(const uint8_t *puzzles, int stride) {
+    uint32_t failed = 0;
+    for (int unit = 0; unit < G::unitCount; unit++)
+      Lanes::store(units[unit], Lanes::set1(G::allDigits));
+
+    for (int lane = 0; lane < width; lane++) {
+      const uint8_t *puzzle = &puzzles[lane * stride];
+      for (int cell = 0; cell < G::cellCount; cell++) {
+        uint8_t ch = puzzle[cell];
+        mask bit = DIGITS<Box>.num2bit[ch];
+        if (!bit && ch != '0' && ch != '.')
+          failed |= 1u << lane;
+
+        mask *row = &units[G::row(cell)][lane], *col = &units[G::col(cell)][lane], *box = &units[G::box(cell)][lane];
+        if (bit & ~(*row & *col & *box))
+          failed |= 1u << lane;
+
+        cells[cell][lane] = bit;
+        *row &= (mask)~bit;
+        *col &= (mask)~bit;
+        *box &= (mask)~bit;
+      }
+    }
+    return failed;
+  }
+
+  template <size_t... Cell> void sweep(std::index_sequence<Cell...>, vec &changed) {
+    (solve_cell<(int)Cell>(changed), ...);
+  }
+
+  // a cell whose remaining candidates are a single digit takes it, like solve_cell in solverAvx2.c
+  template <int Cell> void solve_cell(vec &changed) {
+    constexpr int row = G::row(Cell), col = G::col(Cell), box = G::box(Cell);
+
+    vec p = Lanes::load(cells[Cell]);
+    vec rowVec = Lanes::load(units[row]), colVec = Lanes::load(units[col]), boxVec = Lanes::load(units[box]);
+    vec bits = Lanes::or_(Lanes::and_(Lanes::and_(rowVec, colVec), boxVec), p);
+    vec single = Lanes::cmpeq(Lanes::and_(bits, Lanes::sub(bits, Lanes::set1(1))), Lanes::set1(0));
+    vec placed = Lanes::andnot(p, Lanes::and_(single, bits));
+
+    Lanes::store(cells[Cell], Lanes::or_(p, placed));
+    Lanes::store(units[row], Lanes::andnot(placed, rowVec));
+    Lanes::store(units[col], Lanes::andnot(placed, colVec));
+    Lanes::store(units[box], Lanes::andnot(placed, boxVec));
+    changed = Lanes::or_(changed, placed);
+  }
+
+  template <size_t... Unit> void hidden_sweep(std::index_sequence<Unit...>, vec &changed) {
+    (hidden_unit<(int)Unit>(std::make_index_sequence<G::size>(), changed), ...);
+  }
+
+  template <int Cell> vec candidates() {
+    vec p = Lanes::load(cells[Cell]);
+    vec open = Lanes::cmpeq(p, Lanes::set1(0));
+    vec remaining = Lanes::and_(Lanes::and_(Lanes::load(units[G::row(Cell)]), Lanes::load(units[G::col(Cell)])),
+                                Lanes::load(units[G::box(Cell)]));
+    return Lanes::and_(open, remaining);
+  }
+
+  // the remaining digits of the unit that are a candidate of exactly one of its cells
+  template <int Unit, size_t... I> void hidden_unit(std::index_sequence<I...>, vec &changed) {
+    vec once = Lanes::set1(0), twice = Lanes::set1(0);
+    ((twice = Lanes::or_(twice, Lanes::and_(once, candidates<UNITS<Box>.cells[Unit][I]>())),
+      once = Lanes::or_(once, candidates<UNITS<Box>.cells[Unit][I]>())),
+     ...);
+
+    vec hidden = Lanes::andnot(twice, once);
+    (place_hidden<UNITS<Box>.cells[Unit][I]>(hidden, changed), ...);
+  }
+
+  template <int Cell> void place_hidden(vec hidden, vec &changed) {
+    vec bits = Lanes::and_(candidates<Cell>(), hidden);
+    vec single = Lanes::cmpeq(Lanes::and_(bits, Lanes::sub(bits, Lanes::set1(1))), Lanes::set1(0));
+    vec placed = Lanes::and_(single, bits);
+
+    constexpr int row = G::row(Cell), col = G::col(Cell), box = G::box(Cell);
+    Lanes::store(cells[Cell], Lanes::or_(Lanes::load(cells[Cell]), placed));
+    Lanes::store(units[row], Lanes::andnot(placed, Lanes::load(units[row])));
+    Lanes::store(units[col], Lanes::andnot(placed, Lanes::load(units[col])));
+    Lanes::store(units[box], Lanes::andnot(placed, Lanes::load(units[box])));
+    changed = Lanes::or_(changed, placed);
+  }
+
+  void propagate() {
+    vec changed;
+    do {
+      changed = Lanes::set1(0);
+      sweep(std::make_index_sequence<G::cellCount>(), changed);
+      if (Rules::hiddenSingles && !Lanes::any(changed))
+        hidden_sweep(std::make_index_sequence<G::unitCount>(), changed);
+    } while (Lanes::any(changed));
+  }
+
+  // A bit per lane that is stuck: an open cell without a candidate, or a unit with a digit left that none of its open
+  // cells can take. open gets the lanes that still have an open cell.
+  uint32_t contradictions(uint32_t &open) {
+    vec zero = Lanes::set1(0), anyOpen = zero, stuck = zero;
+    for (int cell = 0; cell < G::cellCount; cell++) {
+      vec isOpen = Lanes::cmpeq(Lanes::load(cells[cell]), zero);
+      vec remaining = Lanes::and_(Lanes::and_(Lanes::load(units[G::row(cell)]), Lanes::load(units[G::col(cell)])),
+                                  Lanes::load(units[G::box(cell)]));
+      anyOpen = Lanes::or_(anyOpen, isOpen);
+      stuck = Lanes::or_(stuck, Lanes::and_(isOpen, Lanes::cmpeq(remaining, zero)));
+    }
+
+    for (int unit = 0; unit < G::unitCount; unit++) {
+      vec covered = zero;
+      for (int cell : UNITS<Box>.cells[unit]) {
+        vec remaining = Lanes::and_(Lanes::and_(Lanes::load(units[G::row(cell)]), Lanes::load(units[G::col(cell)])),
+                                    Lanes::load(units[G::box(cell)]));
+        covered = Lanes::or_(covered, Lanes::and_(Lanes::cmpeq(Lanes::load(cells[cell]), zero), remaining));
+      }
+      stuck = Lanes::or_(stuck, Lanes::cmpeq(Lanes::cmpeq(Lanes::andnot(covered, Lanes::load(units[unit])), zero), zero));
+    }
+
+    open = Lanes::lanes(anyOpen);
+    return Lanes::lanes(stuck);
+  }
+
+  void place(int lane, int cell, mask bit) {
+    cells[cell][lane] = bit;
+    units[G::row(cell)][lane] &= (mask)~bit;
+    units[G::col(cell)][lane] &= (mask)~bit;
+    units[G::box(cell)][lane] &= (mask)~bit;
+  }
+
+  // The lanes the sweeps cannot finish guess together: each picks its open cell with the fewest candidates and the
+  // block tries their candidates in turn, propagating every lane at once after each guess. A lane that gets stuck is
+  // restored from the copy of its level and takes its next candidate. Returns the lanes of active that were solved.
+  uint32_t search(uint32_t active) {
+    propagate();
+    uint32_t open, stuck = contradictions(open);
+    uint32_t solved = active & ~open & ~stuck;
+    active &= open & ~stuck;
+    if (!active)
+      return solved;
+
+    int guessCell[width];
+    mask guesses[width];
+    for (uint32_t lanes = active; lanes; lanes = _blsr_u32(lanes)) {
+      int lane = (int)_tzcnt_u32(lanes), bestCount = G::size + 1;
+      for (int cell = 0; cell < G::cellCount; cell++) {
+        if (cells[cell][lane])
+          continue;
+        mask candidates = (mask)(units[G::row(cell)][lane] & units[G::col(cell)][lane] & units[G::box(cell)][lane]);
+        int count = _mm_popcnt_u32(candidates);
+        if (count < bestCount) {
+          bestCount = count;
+          guessCell[lane] = cell;
+          guesses[lane] = candidates;
+        }
+      }
+    }
+
+    alignas(64) mask savedCells[G::cellCount][width];
+    alignas(64) mask savedUnits[G::unitCount][width];
+    memcpy(savedCells, cells, sizeof(cells));
+    memcpy(savedUnits, units, sizeof(units));
+
+    while (active) {
+      for (uint32_t lanes = active; lanes; lanes = _blsr_u32(lanes)) {
+        int lane = (int)_tzcnt_u32(lanes);
+        mask bit = (mask)_blsi_u32(guesses[lane]);
+        guesses[lane] = (mask)(guesses[lane] ^ bit);
+        place(lane, guessCell[lane], bit);
+      }
+
+      solved |= search(active);
+      active &= ~solved;
+      for (uint32_t lanes = active; lanes; lanes = _blsr_u32(lanes)) {
+        int lane = (int)_tzcnt_u32(lanes);
+        for (int cell = 0; cell < G::cellCount; cell++)
+          cells[cell][lane] = savedCells[cell][lane];
+        for (int unit = 0; unit < G::unitCount; unit++)
+          units[unit][lane] = savedUnits[unit][lane];
+        if (!guesses[lane])
+          active &= ~(1u << lane);
+      }
+    }
+    return solved;
+  }
+};
+
+} // namespace sudoku